@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    KrumEnvelope.cpp
+    Created: 17 Oct 2026 6:02:37pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumEnvelope.h"
+
+void KrumEnvelope::setSampleRate(double newSampleRate)
+{
+    jassert(newSampleRate > 0.0);
+    sampleRate = newSampleRate;
+    recalculateRates();
+}
+
+void KrumEnvelope::setParameters(const juce::ADSR::Parameters& newParameters)
+{
+    parameters = newParameters;
+    recalculateRates();
+}
+
+void KrumEnvelope::recalculateRates()
+{
+    auto getRate = [this](float distance, float timeInSeconds)
+    {
+        return timeInSeconds > 0.0f ? (float)(distance / (timeInSeconds * sampleRate)) : -1.0f;
+    };
+
+    //the release rate is worked out in noteOff()
+    attackRate = getRate(1.0f, parameters.attack);
+    decayRate = getRate(1.0f - parameters.sustain, parameters.decay);
+}
+
+void KrumEnvelope::noteOn()
+{
+    if (attackRate > 0.0f)
+    {
+        state = State::attack;
+    }
+    else if (decayRate > 0.0f)
+    {
+        value = 1.0f;
+        state = State::decay;
+    }
+    else
+    {
+        value = parameters.sustain;
+        state = State::sustain;
+    }
+}
+
+void KrumEnvelope::noteOff()
+{
+    if (state != State::idle)
+    {
+        //already silent (a note off before the attack got going), there's nothing to release and the rate would be 0
+        if (parameters.release > 0.0f && value > 0.0f)
+        {
+            //the release always takes the release time, from wherever the level is now
+            releaseRate = (float)(value / (parameters.release * sampleRate));
+            state = State::release;
+        }
+        else
+        {
+            reset();
+        }
+    }
+}
+
+void KrumEnvelope::reset()
+{
+    value = 0.0f;
+    state = State::idle;
+}
+
+void KrumEnvelope::goToNextState()
+{
+    if (state == State::attack)
+    {
+        state = decayRate > 0.0f ? State::decay : State::sustain;
+    }
+    else if (state == State::decay)
+    {
+        state = State::sustain;
+    }
+    else if (state == State::release)
+    {
+        reset();
+    }
+}
+
+int KrumEnvelope::writeRamp(float* envelope, int numSamples, float rate, float target)
+{
+    //samples until the ramp reaches the target, the last one is written as the target itself. A ramp that can't move jumps straight there,
+    //and it's capped before the cast so a tiny rate can't overflow the int
+    const float distance = target - value;
+    const float samplesToTarget = rate != 0.0f ? distance / rate : 0.0f;
+    const int numToTarget = juce::jmax(1, (int)std::ceil(juce::jmin(samplesToTarget, (float)numSamples + 1.0f)));
+    const int num = juce::jmin(numSamples, numToTarget);
+    const float start = value;
+
+    for (int i = 0; i < num; i++)
+    {
+        envelope[i] = start + rate * (float)(i + 1);
+    }
+
+    if (num == numToTarget)
+    {
+        envelope[num - 1] = target;
+        value = target;
+        goToNextState();
+    }
+    else
+    {
+        value = envelope[num - 1];
+    }
+
+    return num;
+}
+
+const float* KrumEnvelope::getNextBlock(float* envelope, int numSamples, float& level)
+{
+    if (state == State::idle || state == State::sustain)
+    {
+        level = state == State::idle ? 0.0f : parameters.sustain;
+        return nullptr;
+    }
+
+    int i = 0;
+    while (i < numSamples)
+    {
+        switch (state)
+        {
+        case State::attack:
+            i += writeRamp(envelope + i, numSamples - i, attackRate, 1.0f);
+            break;
+        case State::decay:
+            i += writeRamp(envelope + i, numSamples - i, -decayRate, parameters.sustain);
+            break;
+        case State::release:
+            i += writeRamp(envelope + i, numSamples - i, -releaseRate, 0.0f);
+            break;
+        case State::sustain:
+            juce::FloatVectorOperations::fill(envelope + i, parameters.sustain, numSamples - i);
+            i = numSamples;
+            break;
+        case State::idle:
+        default:
+            juce::FloatVectorOperations::clear(envelope + i, numSamples - i);
+            i = numSamples;
+            break;
+        }
+    }
+
+    level = value;
+    return envelope;
+}
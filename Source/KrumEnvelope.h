@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    KrumEnvelope.h
+    Created: 17 Oct 2026 6:02:37pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+/*
+*
+* A linear ADSR that works out a whole block at a time, used by the voices instead of juce::ADSR.
+*
+* juce::ADSR has to be asked for every sample, and runs it's state machine each time. For a one shot the envelope sits at the sustain level
+* for almost the whole sample, so getNextBlock() tells the voice when the block is flat and the kernels fold the level into the gain instead.
+* The attack, decay and release are written out as ramps.
+*
+* It takes the same juce::ADSR::Parameters and follows the same shape as juce::ADSR, the ramps are worked out from where the segment started
+* instead of adding up the rate every sample, so the level can be a float ulp or two off from juce::ADSR, and a segment can end a sample
+* sooner or later than it would have.
+*
+*/
+
+class KrumEnvelope
+{
+public:
+    void setSampleRate(double newSampleRate);
+    void setParameters(const juce::ADSR::Parameters& newParameters);
+
+    void noteOn();
+    void noteOff();
+    void reset();
+
+    bool isActive() const { return state != State::idle; }
+
+    //the last level the envelope gave out, or where it's heading during the attack, so a note that just started never looks quiet
+    float getLevel() const { return state == State::attack ? 1.0f : value; }
+
+    //Returns nullptr if the envelope is flat at level for the whole block, otherwise fills envelope with numSamples levels and returns it.
+    //If the envelope finishes in this block, the rest of the block is 0.0 and isActive() will be false afterwards.
+    const float* getNextBlock(float* envelope, int numSamples, float& level);
+
+private:
+    enum class State { idle, attack, decay, sustain, release };
+
+    void recalculateRates();
+    void goToNextState();
+
+    //writes up to numSamples of a ramp from value by rate (can be negative) towards target, returns the number written.
+    //When target is reached it's written exactly and the state moves on
+    int writeRamp(float* envelope, int numSamples, float rate, float target);
+
+    State state = State::idle;
+    juce::ADSR::Parameters parameters;
+    double sampleRate = 44100.0;
+
+    float value = 0.0f;
+    float attackRate = 0.0f, decayRate = 0.0f, releaseRate = 0.0f;
+};
@@ -0,0 +1,220 @@
+/*
+  ==============================================================================
+
+    KrumMemoryPinning.cpp
+    Created: 17 Oct 2026 11:48:31pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumMemoryPinning.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <sys/mman.h>
+ #include <sys/resource.h>
+#endif
+
+static std::atomic<int> numPinRequests { 0 };
+static std::atomic<juce::int64> pinningLimit { 0 };
+static std::atomic<juce::int64> lockedBytes { 0 };
+static std::atomic<juce::int64> unlockedBytes { 0 };
+
+//every lock and unlock goes through here, so the limit is checked and counted in one go
+static juce::CriticalSection pinningLock;
+static juce::Array<KrumPinnedBlock*> lockedBlocks;
+static bool loggedLimit = false, loggedRefused = false;
+
+void KrumMemoryPinning::addPinRequest()
+{
+    ++numPinRequests;
+}
+
+void KrumMemoryPinning::removePinRequest()
+{
+    jassert(numPinRequests.load() > 0);
+    --numPinRequests;
+}
+
+bool KrumMemoryPinning::isEnabled()
+{
+    return numPinRequests.load() > 0;
+}
+
+void KrumMemoryPinning::unpinAll()
+{
+    const juce::ScopedLock sl(pinningLock);
+
+    //turned back on since this was asked for, leave it
+    if (isEnabled())
+    {
+        return;
+    }
+
+    //unpin() takes itself out of the array
+    while (!lockedBlocks.isEmpty())
+    {
+        lockedBlocks.getLast()->unpin();
+    }
+}
+
+void KrumMemoryPinning::setLimit(juce::int64 numBytes)
+{
+    pinningLimit = juce::jmax((juce::int64)0, numBytes);
+}
+
+juce::int64 KrumMemoryPinning::getLimit()
+{
+    return pinningLimit;
+}
+
+juce::int64 KrumMemoryPinning::getLockedBytes()
+{
+    return lockedBytes;
+}
+
+juce::int64 KrumMemoryPinning::getUnlockedBytes()
+{
+    return unlockedBytes;
+}
+
+//the most the OS will let us lock, -1 if it doesn't say
+static juce::int64 getSystemLockLimit()
+{
+#if JUCE_WINDOWS
+    return -1;  //VirtualLock is capped by the working set instead, we just find out when it fails
+#else
+    rlimit limit;
+    if (getrlimit(RLIMIT_MEMLOCK, &limit) != 0 || limit.rlim_cur == RLIM_INFINITY)
+    {
+        return -1;
+    }
+
+    return (juce::int64)limit.rlim_cur;
+#endif
+}
+
+static bool lockPages(void* start, size_t numBytes)
+{
+#if JUCE_WINDOWS
+    return VirtualLock(start, numBytes) != 0;
+#else
+    return mlock(start, numBytes) == 0;
+#endif
+}
+
+static void unlockPages(void* start, size_t numBytes)
+{
+#if JUCE_WINDOWS
+    VirtualUnlock(start, numBytes);
+#else
+    munlock(start, numBytes);
+#endif
+}
+
+//==================================================================================================//
+
+KrumPinnedBlock::~KrumPinnedBlock()
+{
+    unpin();
+}
+
+bool KrumPinnedBlock::isLocked() const
+{
+    const juce::ScopedLock sl(pinningLock);
+    return lockedStart != nullptr;
+}
+
+void KrumPinnedBlock::pin(const void* data, size_t numBytes)
+{
+    if (data == nullptr || numBytes == 0)
+    {
+        return;
+    }
+
+    const size_t pageSize = (size_t)juce::SystemStats::getPageSize();
+
+    //touched first, so the block is in memory even if it can't be locked
+    auto* bytes = static_cast<const volatile char*>(data);
+    for (size_t i = 0; i < numBytes; i += pageSize)
+    {
+        (void)bytes[i];
+    }
+
+    //only the whole pages inside the block, the partial pages at the ends can belong to something else
+    const auto blockStart = (juce::pointer_sized_uint)data;
+    const auto firstPage = (blockStart + pageSize - 1) / pageSize * pageSize;
+    const auto endPage = (blockStart + numBytes) / pageSize * pageSize;
+
+    if (endPage <= firstPage)
+    {
+        return;
+    }
+
+    const size_t numToLock = endPage - firstPage;
+
+    const juce::ScopedLock sl(pinningLock);
+
+    //shared data can be pinned by two loads at once, and pinning can be turned off while the pages were being touched
+    if (lockedStart != nullptr || !KrumMemoryPinning::isEnabled())
+    {
+        return;
+    }
+
+    const juce::int64 systemLimit = getSystemLockLimit();
+    const juce::int64 totalLocked = lockedBytes.load() + (juce::int64)numToLock;
+
+    if (totalLocked > pinningLimit.load() || (systemLimit >= 0 && totalLocked > systemLimit))
+    {
+        unlockedBytes += (juce::int64)numToLock;
+
+        if (!loggedLimit)
+        {
+            loggedLimit = true;
+            juce::Logger::writeToLog("Pin Samples: limit reached, " + juce::File::descriptionOfSizeInBytes(lockedBytes.load()) + " locked. Limit: "
+                                     + juce::File::descriptionOfSizeInBytes(pinningLimit.load()) + ", RLIMIT_MEMLOCK: "
+                                     + (systemLimit >= 0 ? juce::File::descriptionOfSizeInBytes(systemLimit) : juce::String("none"))
+                                     + ". The rest of the samples are touched, not locked");
+        }
+
+        return;
+    }
+
+    if (!lockPages((void*)firstPage, numToLock))
+    {
+        unlockedBytes += (juce::int64)numToLock;
+
+        if (!loggedRefused)
+        {
+            loggedRefused = true;
+            juce::Logger::writeToLog("Pin Samples: the OS refused to lock " + juce::File::descriptionOfSizeInBytes((juce::int64)numToLock)
+                                     + " with " + juce::File::descriptionOfSizeInBytes(lockedBytes.load()) + " locked. The rest of the samples are touched, not locked");
+        }
+
+        return;
+    }
+
+    lockedStart = (void*)firstPage;
+    lockedSize = numToLock;
+    lockedBytes += (juce::int64)numToLock;
+    lockedBlocks.add(this);
+}
+
+void KrumPinnedBlock::unpin()
+{
+    const juce::ScopedLock sl(pinningLock);
+
+    if (lockedStart == nullptr)
+    {
+        return;
+    }
+
+    unlockPages(lockedStart, lockedSize);
+    lockedBytes -= (juce::int64)lockedSize;
+    lockedBlocks.removeFirstMatchingValue(this);
+
+    lockedStart = nullptr;
+    lockedSize = 0;
+}
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    KrumMemoryPinning.h
+    Created: 17 Oct 2026 11:48:31pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+/*
+*
+* Pin samples mode. When it's on, the sample data is locked into RAM as it's loaded, so the OS can't page it out from under the voices.
+*
+* The sample data is shared between instances (see KrumSamplePool), so this is all process wide. Each instance that wants pinning adds a request,
+* pinning stays on while any instance still wants it, and everything is unpinned once the last request is removed. The limit is the last one set.
+* The memory locked is capped by the limit set here and, on Mac and Linux, by the process's RLIMIT_MEMLOCK. Past either, or if the OS refuses,
+* the pages are still touched so they're in memory when the first note plays, they just aren't locked. The first time that happens it's logged.
+*
+* Locks don't stack, unlocking a page unlocks it for everyone, so a KrumPinnedBlock only ever locks the whole pages inside it's own block.
+*
+*/
+
+struct KrumMemoryPinning
+{
+    //one per instance that has the setting on, take it away when the setting goes off or the instance goes
+    static void addPinRequest();
+    static void removePinRequest();
+    static bool isEnabled();
+
+    //Unpins every locked block if nothing wants pinning anymore. Loader pool, unlocking a lot of memory isn't free
+    static void unpinAll();
+
+    static void setLimit(juce::int64 numBytes);
+    static juce::int64 getLimit();
+
+    //the bytes locked right now, and the bytes that should have been but weren't (since the plugin was loaded)
+    static juce::int64 getLockedBytes();
+    static juce::int64 getUnlockedBytes();
+};
+
+//A block of sample memory that can be pinned, it's unlocked when this goes, so declare it after the memory it pins.
+class KrumPinnedBlock
+{
+public:
+    KrumPinnedBlock() = default;
+    ~KrumPinnedBlock();
+
+    //Touches every page of the block, then locks it if pinning is on and it fits. Does nothing if it's already locked. Slow for a big block,
+    //keep it on the loader pool
+    void pin(const void* data, size_t numBytes);
+    void unpin();
+
+    bool isLocked() const;
+
+private:
+    void* lockedStart = nullptr;
+    size_t lockedSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(KrumPinnedBlock)
+};
@@ -14,6 +14,20 @@
 KrumModule::KrumModule(KrumSampler& km, juce::ValueTree& valTree, juce::AudioProcessorValueTreeState* apvts)
     : moduleTree(valTree), parameters(apvts), sampler(km)
 {
+    juce::String i = moduleTree.getProperty(TreeIDs::moduleSamplerIndex).toString();
+
+    gainParameter = parameters->getRawParameterValue(TreeIDs::paramModuleGain + i);
+    clipGainParameter = parameters->getRawParameterValue(TreeIDs::paramModuleClipGain + i);
+    panParameter = parameters->getRawParameterValue(TreeIDs::paramModulePan + i);
+    outputChannelParameter = parameters->getRawParameterValue(TreeIDs::paramModuleOutputChannel + i);
+    muteParameter = parameters->getRawParameterValue(TreeIDs::paramModuleMute + i);
+    reverseParameter = parameters->getRawParameterValue(TreeIDs::paramModuleReverse + i);
+    pitchShiftParameter = parameters->getRawParameterValue(TreeIDs::paramModulePitchShift + i);
+
+    updateSampleRange();
+    updateInterpolation();
+    updateMaxVoices();
+
     moduleTree.addListener(this);
 }
 
@@ -26,25 +40,41 @@ void KrumModule::valueTreePropertyChanged(juce::ValueTree& treeWhoChanged, const
     if (treeWhoChanged.hasType(TreeIDs::MODULE) &&
         ((int)treeWhoChanged.getProperty(TreeIDs::moduleSamplerIndex) == getModuleSamplerIndex())) //check to make sure the module that changed is the same as this one
     {
-        if (property == TreeIDs::moduleFile && treeWhoChanged[property].toString().isNotEmpty())
+        if (property == TreeIDs::moduleInterpolationMode)
         {
-            //update module file in sampler
-            updateSamplerSound();
+            //only read when a note starts, nothing to rebuild
+            updateInterpolation();
         }
-        else if (property == TreeIDs::moduleMidiNote && (int)treeWhoChanged[property] > 0)
+        else if (property == TreeIDs::moduleMaxVoices)
         {
-            // update module sound in sampler
-            updateSamplerSound();
+            updateMaxVoices();
+        }
+        else if (restoringTree)
+        {
+            //the sampler sorts out the sound once the whole tree is copied, see restoreFromTree()
+            if (property == TreeIDs::moduleStartSample || property == TreeIDs::moduleEndSample)
+            {
+                updateSampleRange();
+            }
         }
-        else if (property == TreeIDs::moduleMidiChannel && (int)treeWhoChanged[property] > 0)
+        else if (property == TreeIDs::moduleFile && treeWhoChanged[property].toString().isNotEmpty())
         {
-            //update module sound in sampler
+            //update module file in sampler
             updateSamplerSound();
         }
+        else if ((property == TreeIDs::moduleMidiNote || property == TreeIDs::moduleMidiChannel) && (int)treeWhoChanged[property] > 0)
+        {
+            //only the mapping changed, the sound keeps it's audio
+            sampler.updateModuleMidiMapping(this);
+        }
         else if (property == TreeIDs::moduleState && (int)treeWhoChanged[property] == KrumModule::ModuleState::empty)
         {
             removeSamplerSound();
         }
+        else if (property == TreeIDs::moduleStartSample || property == TreeIDs::moduleEndSample)
+        {
+            updateSampleRange();
+        }
     }
 }
 
@@ -106,57 +136,70 @@ juce::Colour KrumModule::getModuleColor()
 
 std::atomic<float>* KrumModule::getModuleGain()
 {
-    return parameters->getRawParameterValue(TreeIDs::paramModuleGain + getIndexString());
+    return gainParameter;
 }
 
 std::atomic<float>* KrumModule::getModuleClipGain()
 {
-    return parameters->getRawParameterValue(TreeIDs::paramModuleClipGain + getIndexString());
+    return clipGainParameter;
 }
 
 std::atomic<float>* KrumModule::getModulePan()
 {
-    return parameters->getRawParameterValue(TreeIDs::paramModulePan + getIndexString());
+    return panParameter;
 }
 
 std::atomic<float>* KrumModule::getModuleOutputChannel()
 {
-    return parameters->getRawParameterValue(TreeIDs::paramModuleOutputChannel + getIndexString());
+    return outputChannelParameter;
 }
 
-std::atomic<int> KrumModule::getModuleStartSample()
+int KrumModule::getModuleStartSample()
 {
-    int startSample = (int)moduleTree.getProperty(TreeIDs::moduleStartSample);
-    return startSample;
+    return (int)(sampleRange.load() >> 32);
 }
     
-std::atomic<int> KrumModule::getModuleEndSample()
+int KrumModule::getModuleEndSample()
 {
-    int endSample = (int)moduleTree.getProperty(TreeIDs::moduleEndSample);
-    return endSample;
-    
+    return (int)(sampleRange.load() & 0xffffffff);
+}
+
+void KrumModule::getModuleSampleRange(int& startSample, int& endSample)
+{
+    auto range = sampleRange.load();
+    startSample = (int)(range >> 32);
+    endSample = (int)(range & 0xffffffff);
 }
 
 std::atomic<float>* KrumModule::getModuleMute()
 {
-    return parameters->getRawParameterValue(TreeIDs::paramModuleMute + getIndexString());
+    return muteParameter;
 }
 
 std::atomic<float>* KrumModule::getModuleReverse()
 {
-    return parameters->getRawParameterValue(TreeIDs::paramModuleReverse + getIndexString());
+    return reverseParameter;
 }
 
 std::atomic<float>* KrumModule::getModulePitchShift()
 {
-    return parameters->getRawParameterValue(TreeIDs::paramModulePitchShift + getIndexString());
+    return pitchShiftParameter;
 }
 
+//the choices are stereo pairs ("1-2", "3-4"...), so the first channel of the pair is (index * 2) + 1
 int KrumModule::getModuleOutputChannelNumber()
 {
-    auto outputString = TreeIDs::outputStrings.getReference((int)*getModuleOutputChannel());
+    return ((int)*outputChannelParameter * 2) + 1;
+}
 
-    return outputString.dropLastCharacters(2).getIntValue();
+int KrumModule::getModuleInterpolation()
+{
+    return interpolation.load();
+}
+
+int KrumModule::getModuleMaxVoices()
+{
+    return maxVoices.load();
 }
 
 void KrumModule::setNumSamplesInFile(int numSamples)
@@ -164,6 +207,25 @@ void KrumModule::setNumSamplesInFile(int numSamples)
     moduleTree.setProperty(TreeIDs::moduleNumSamplesLength, numSamples, nullptr);
 }
 
+KrumSound* KrumModule::getPlaybackSound()
+{
+    return playbackSound.load();
+}
+
+bool KrumModule::isLoading()
+{
+    return loading;
+}
+
+void KrumModule::restoreFromTree(const juce::ValueTree& newModuleTree)
+{
+    int samplerIndex = getModuleSamplerIndex();
+
+    restoringTree = true;
+    moduleTree.copyPropertiesFrom(newModuleTree, nullptr);
+    moduleTree.setProperty(TreeIDs::moduleSamplerIndex, samplerIndex, nullptr); //the tree index never changes
+    restoringTree = false;
+}
 
 void KrumModule::updateSamplerSound()
 {
@@ -175,7 +237,19 @@ void KrumModule::removeSamplerSound()
     sampler.removeModuleSample(this);
 }
 
-juce::String KrumModule::getIndexString()
+void KrumModule::updateSampleRange()
+{
+    auto startSample = (juce::uint32)(int)moduleTree.getProperty(TreeIDs::moduleStartSample);
+    auto endSample = (juce::uint32)(int)moduleTree.getProperty(TreeIDs::moduleEndSample);
+    sampleRange = ((juce::uint64)startSample << 32) | endSample;
+}
+
+void KrumModule::updateInterpolation()
+{
+    interpolation = (int)moduleTree.getProperty(TreeIDs::moduleInterpolationMode);
+}
+
+void KrumModule::updateMaxVoices()
 {
-    return juce::String(getModuleSamplerIndex());
+    maxVoices = juce::jmax(0, (int)moduleTree.getProperty(TreeIDs::moduleMaxVoices));
 }
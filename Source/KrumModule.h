@@ -28,6 +28,7 @@
 
 
 class KrumSampler;
+class KrumSound;
 
 class KrumModule  : public juce::ValueTree::Listener
 {
@@ -78,29 +79,72 @@ public:
     std::atomic<float>* getModuleClipGain();
     std::atomic<float>* getModulePan();
     std::atomic<float>* getModuleOutputChannel();
-    std::atomic<int> getModuleStartSample();
-    std::atomic<int> getModuleEndSample();
+    int getModuleStartSample();
+    int getModuleEndSample();
+    void getModuleSampleRange(int& startSample, int& endSample);
     std::atomic<float>* getModuleMute();
     std::atomic<float>* getModuleReverse();
     std::atomic<float>* getModulePitchShift();
 
     int getModuleOutputChannelNumber();
 
+    //the module's own KrumRender::Interpolation, 0 means use the global setting, see KrumSampler::getInterpolation()
+    int getModuleInterpolation();
+
+    //most voices this module can play at once, 0 means no limit. A new hit on a module at it's limit retriggers it's quietest voice
+    int getModuleMaxVoices();
+
     void setNumSamplesInFile(int numSamples);
 
+    //the sound the voices play, nullptr until the sampler has finished loading the file
+    KrumSound* getPlaybackSound();
+    bool isLoading();
+
+    //copies the settings from a restored module tree into this module's tree, without kicking off any sample loads.
+    //The sampler decides what needs to be reloaded afterwards, see KrumSampler::restoreModules()
+    void restoreFromTree(const juce::ValueTree& newModuleTree);
+
 private:
 
     void updateSamplerSound();
     void removeSamplerSound();
-    juce::String getIndexString();
+    void updateSampleRange();
+    void updateInterpolation();
+    void updateMaxVoices();
 
     bool needsToUpdateTree = false;
+    bool restoringTree = false;
 
     friend class KrumModuleEditor;
     friend class DragAndDropThumbnail;
+    friend class KrumSampler;
 
     juce::AudioProcessorValueTreeState* parameters = nullptr;
     juce::ValueTree moduleTree;
+
+    //These are read by the voices on the audio thread, so we look them up once here instead of building the parameter IDs on every note
+    std::atomic<float>* gainParameter = nullptr;
+    std::atomic<float>* clipGainParameter = nullptr;
+    std::atomic<float>* panParameter = nullptr;
+    std::atomic<float>* outputChannelParameter = nullptr;
+    std::atomic<float>* muteParameter = nullptr;
+    std::atomic<float>* reverseParameter = nullptr;
+    std::atomic<float>* pitchShiftParameter = nullptr;
+
+    //start sample in the high 32 bits, end sample in the low 32 bits, so the audio thread always gets a matching pair
+    std::atomic<juce::uint64> sampleRange { 0 };
+
+    //cached from the tree for the audio thread
+    std::atomic<int> interpolation { 0 };
+    std::atomic<int> maxVoices { 0 };
+
+    //only the sampler swaps this, on the message thread, when a load finishes. The audio thread reads it in KrumSampler::noteOn()
+    std::atomic<KrumSound*> playbackSound { nullptr };
+
+    //these are only touched on the message thread, loadId is bumped every time a new load is started so older loads can be thrown away
+    bool loading = false;
+    bool rebuilding = false;    //the sound is being rebuilt for a new host rate or bake, this doesn't show as loading
+    int loadId = 0;
     
     KrumSampler& sampler;
 
@@ -118,6 +118,39 @@ void KrumModuleEditor::paint (juce::Graphics& g)
     }
 }
 
+void KrumModuleEditor::paintOverChildren(juce::Graphics& g)
+{
+    if (moduleLoading)
+    {
+        auto area = thumbnail.isVisible() ? thumbnail.getBoundsInParent() : getLocalBounds().reduced(EditorDimensions::shrinkage);
+
+        g.setColour(juce::Colours::black.withAlpha(0.6f));
+        g.fillRoundedRectangle(area.toFloat(), EditorDimensions::cornerSize);
+
+        juce::String loadingText = "Loading...";
+
+        //when a whole kit is being restored, show how far along it is
+        int numLoaded = 0, numToLoad = 0;
+        if (editor.sampler.isRestoringModules())
+        {
+            editor.sampler.getRestoreProgress(numLoaded, numToLoad);
+            loadingText << "\n" << numLoaded << "/" << numToLoad;
+        }
+
+        g.setColour(juce::Colours::white);
+        g.drawFittedText(loadingText, area, juce::Justification::centred, 2);
+    }
+    else if (moduleResidentBytes > 0 && thumbnail.isVisible())
+    {
+        auto area = thumbnail.getBoundsInParent().reduced(4, 2);
+        juce::String memoryText = moduleStorageName + " " + juce::File::descriptionOfSizeInBytes(moduleResidentBytes);
+
+        g.setColour(juce::Colours::white.withAlpha(0.6f));
+        g.setFont(10.0f);
+        g.drawFittedText(memoryText, area, juce::Justification::bottomRight, 1);
+    }
+}
+
 void KrumModuleEditor::resized()
 {
     auto area = getLocalBounds().reduced(EditorDimensions::shrinkage);
@@ -1069,6 +1102,25 @@ void KrumModuleEditor::timerCallback()
         repaint();
     }
 
+    bool loading = editor.sampler.isModuleLoading(getModuleSamplerIndex());
+    int numLoaded = 0, numToLoad = 0;
+    editor.sampler.getRestoreProgress(numLoaded, numToLoad);
+
+    if (loading != moduleLoading || (loading && numLoaded != numKitSamplesLoaded))
+    {
+        moduleLoading = loading;
+        numKitSamplesLoaded = numLoaded;
+        repaint();
+    }
+
+    auto residentBytes = editor.sampler.getModuleResidentBytes(getModuleSamplerIndex());
+    if (residentBytes != moduleResidentBytes)
+    {
+        moduleResidentBytes = residentBytes;
+        moduleStorageName = editor.sampler.getModuleStorageName(getModuleSamplerIndex());
+        repaint();
+    }
+
 }
 
 void KrumModuleEditor::printValueAndPositionOfSlider()
@@ -60,6 +60,7 @@ public:
     ~KrumModuleEditor() override;
 
     void paint (juce::Graphics&) override;
+    void paintOverChildren(juce::Graphics& g) override;
     
     void paintVolumeSliderLines(juce::Graphics& g, juce::Rectangle<float> bounds);
     void paintPanSliderLines(juce::Graphics& g, juce::Rectangle<float> bounds);
@@ -190,6 +191,14 @@ private:
     
     bool modulePlaying = false;
 
+    //true while the sampler is decoding this module's sample, polled in timerCallback()
+    bool moduleLoading = false;
+    int numKitSamplesLoaded = 0;
+
+    //the memory the module's sound takes up and how it's kept, polled in timerCallback() and drawn over the thumbnail
+    juce::int64 moduleResidentBytes = 0;
+    juce::String moduleStorageName;
+
     juce::Colour thumbBgColor{ juce::Colours::darkgrey.darker() };
     juce::Colour titleFontColor{ juce::Colours::black };
 
@@ -0,0 +1,640 @@
+/*
+  ==============================================================================
+
+    KrumRenderKernels.h
+    Created: 17 Oct 2026 9:12:05am
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "KrumResampler.h"
+
+#if defined(__AVX2__)
+ #include <immintrin.h>
+#elif JUCE_INTEL
+ #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #include <arm_neon.h>
+#endif
+
+/*
+*
+* Block render kernels used by the sampler voices.
+*
+* A voice renders its block in chunks of up to renderChunkSize samples, each chunk is made in two passes:
+*   1. read     - reads the source at the voice's playback rate into a small scratch buffer owned by the voice, applying the envelope.
+*   2. mix      - applies the gains and sums the scratch buffer into the output buffer.
+*
+* When the envelope is flat for the whole chunk (see KrumEnvelope) the voice passes a level instead of an envelope buffer,
+* the read pass doesn't multiply anything and the level is folded into the mix gains. A forward unity read then
+* skips the scratch buffer completely and the mix reads straight from the sample.
+*
+* Every kernel is a template specialized on { forward/reverse, mono/stereo source, mono/stereo output, interpolation },
+* the voice picks its kernels with getKernel() in startNote() so nothing in the inner loops branches on those settings.
+* The unity kernels are used when the sample plays unpitched at the host rate, they don't interpolate at all
+* and the forward ones are just vector multiplies and adds.
+*
+* The resampling kernels can use one of three interpolators, see Interpolation. They read either side of the position,
+* the sample data keeps enough silence around the audio that they never have to check, see KrumSampleData.
+* The forward unity reads and the mix use juce::FloatVectorOperations. The linear and hermite reads and the reverse unity read do their
+* maths SimdFloats::size samples at a time, see SimdFloats, the resampling reads still gather their taps a sample at a time.
+* The scalar kernels are kept as the fallback for anything without SSE or NEON, and for the sinc reads, see getScalarKernel().
+* The vector kernels do the same sums in the same order, so they only differ from the scalar ones where the compiler fuses a multiply
+* and add in one and not the other. See Tests/Source/KernelBenchmarks.cpp for how they compare to each other and to the old per-sample loop.
+*
+* Tolerance: the old per-sample loop did ((sample * clipGain) * (gain * envelope)), the kernels do ((sample * envelope) * (clipGain * gain)).
+* The result can differ by a few float ulps (less than 1.0e-6 relative to the sample value).
+*
+* The playback position is 32.32 fixed point, see toPhase(). The whole sample and the fraction are just a shift and a mask,
+* and stepping by an integer increment never drifts, no matter how long the note plays. Against the old double position the
+* increment is rounded to 1/2^32 of a sample, unpitched notes and the sample where the voice stops are exactly the same.
+*
+*/
+
+namespace KrumRender
+{
+    //the voices keep their scratch buffers on the stack of the voice object, so keep this small
+    constexpr int renderChunkSize = 64;
+
+    //numerical values are saved in the value tree, see KrumSampler::getInterpolation()
+    enum Interpolation
+    {
+        none,       //unity kernels only, the position never lands between samples
+        linear,     //2 points, cheapest, dulls the top end and lets through some aliasing when pitched
+        hermite,    //4 point cubic hermite, a good default for pitched drums
+        sinc,       //windowed sinc, see KrumResampler::getPlaybackSincTable(), the most expensive by far
+        numInterpolations
+    };
+
+    //the fraction of a sample is the low 32 bits of a phase, the whole samples are the high 32 bits
+    constexpr int phaseFractionBits = 32;
+    constexpr float phaseToFraction = 1.0f / 4294967296.0f;
+
+    inline juce::int64 toPhase(double samples)
+    {
+        return (juce::int64)std::llround(samples * 4294967296.0);
+    }
+
+    //everything a kernel needs to know about the note, filled in by the voice when the note starts
+    struct VoiceRenderState
+    {
+        const float* inL = nullptr;
+        const float* inR = nullptr;     //nullptr for mono sources
+
+        //all phases, see toPhase()
+        juce::int64 position = 0;
+        juce::int64 increment = 0;      //always positive, the direction is part of the kernel
+        juce::int64 lowerBound = 0;     //the voice is done when the position leaves [lowerBound, upperBound]
+        juce::int64 upperBound = 0;
+
+        float gainL = 0;                //clip gain, module gain, pan and velocity combined
+        float gainR = 0;
+
+        const SincTable* sincTable = nullptr;   //only used by the sinc kernels
+
+        bool isFinished() const
+        {
+            return position > upperBound || position < lowerBound;
+        }
+    };
+
+    //Renders up to numSamples into outL/outR (outR is ignored by the mono output kernels) and returns the number of samples rendered.
+    //Rendering stops early when the position leaves the bounds, check VoiceRenderState::isFinished() after each call.
+    //envelope is nullptr when the envelope sits at envelopeLevel for the whole chunk.
+    using RenderKernel = int (*) (VoiceRenderState& state, float* outL, float* outR, const float* envelope, float envelopeLevel,
+                                  float* scratchL, float* scratchR, int numSamples);
+
+    //------------------------------------------------------------------------------------------------------------
+
+    //The vector the kernels work in. 8 floats with AVX2 (only if the build turns it on), 4 with SSE2 on any other x86 and with NEON on ARM.
+    //Anything else gets a single float, and only the scalar kernels are used.
+    //The phase fractions are kept as 32 bit ints, a lane each, and turned into the same alpha the scalar kernels work out.
+    //The taps are gathered with a load per position, the linear ones in pairs and the hermite ones in fours, then transposed
+    struct SimdFloats
+    {
+       #if defined(__AVX2__)
+        using Type = __m256;
+        using Fractions = __m256i;
+        static constexpr int size = 8;
+        static constexpr const char* name = "AVX2";
+
+        static Type expand(float value)         { return _mm256_set1_ps(value); }
+        static Type load(const float* p)        { return _mm256_loadu_ps(p); }
+        static void store(float* p, Type v)     { _mm256_storeu_ps(p, v); }
+        static Type add(Type a, Type b)         { return _mm256_add_ps(a, b); }
+        static Type sub(Type a, Type b)         { return _mm256_sub_ps(a, b); }
+        static Type mul(Type a, Type b)         { return _mm256_mul_ps(a, b); }
+
+        //last float first, swaps the halves then flips each of them
+        static Type reverse(Type v)             { return _mm256_permute_ps(_mm256_permute2f128_ps(v, v, 1), _MM_SHUFFLE(0, 1, 2, 3)); }
+
+        static Fractions loadFractions(const juce::uint32* f)    { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(f)); }
+        static Fractions addFractions(Fractions f, juce::uint32 step) { return _mm256_add_epi32(f, _mm256_set1_epi32((int)step)); }
+
+        //there's no unsigned convert, the top and bottom 16 bits are each exact as floats so their sum is only rounded once
+        static Type toAlpha(Fractions f)
+        {
+            const auto top = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(f, 16)), _mm256_set1_ps(65536.0f));
+            const auto bottom = _mm256_cvtepi32_ps(_mm256_and_si256(f, _mm256_set1_epi32(0xffff)));
+            return _mm256_mul_ps(_mm256_add_ps(top, bottom), _mm256_set1_ps(phaseToFraction));
+        }
+
+        static void gatherPairs(const float* in, const int* pos, Type& x0, Type& x1)
+        {
+            __m128 lowX0, lowX1, highX0, highX1;
+            gatherFourPairs(in, pos, lowX0, lowX1);
+            gatherFourPairs(in, pos + 4, highX0, highX1);
+
+            x0 = _mm256_insertf128_ps(_mm256_castps128_ps256(lowX0), highX0, 1);
+            x1 = _mm256_insertf128_ps(_mm256_castps128_ps256(lowX1), highX1, 1);
+        }
+
+        static void gatherQuads(const float* in, const int* pos, Type& xm1, Type& x0, Type& x1, Type& x2)
+        {
+            __m128 low[4], high[4];
+            gatherFourQuads(in, pos, low);
+            gatherFourQuads(in, pos + 4, high);
+
+            xm1 = _mm256_insertf128_ps(_mm256_castps128_ps256(low[0]), high[0], 1);
+            x0 = _mm256_insertf128_ps(_mm256_castps128_ps256(low[1]), high[1], 1);
+            x1 = _mm256_insertf128_ps(_mm256_castps128_ps256(low[2]), high[2], 1);
+            x2 = _mm256_insertf128_ps(_mm256_castps128_ps256(low[3]), high[3], 1);
+        }
+       #elif JUCE_INTEL
+        using Type = __m128;
+        using Fractions = __m128i;
+        static constexpr int size = 4;
+        static constexpr const char* name = "SSE2";
+
+        static Type expand(float value)         { return _mm_set1_ps(value); }
+        static Type load(const float* p)        { return _mm_loadu_ps(p); }
+        static void store(float* p, Type v)     { _mm_storeu_ps(p, v); }
+        static Type add(Type a, Type b)         { return _mm_add_ps(a, b); }
+        static Type sub(Type a, Type b)         { return _mm_sub_ps(a, b); }
+        static Type mul(Type a, Type b)         { return _mm_mul_ps(a, b); }
+        static Type reverse(Type v)             { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3)); }
+
+        static Fractions loadFractions(const juce::uint32* f)    { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(f)); }
+        static Fractions addFractions(Fractions f, juce::uint32 step) { return _mm_add_epi32(f, _mm_set1_epi32((int)step)); }
+
+        //see the AVX2 version
+        static Type toAlpha(Fractions f)
+        {
+            const auto top = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(f, 16)), _mm_set1_ps(65536.0f));
+            const auto bottom = _mm_cvtepi32_ps(_mm_and_si128(f, _mm_set1_epi32(0xffff)));
+            return _mm_mul_ps(_mm_add_ps(top, bottom), _mm_set1_ps(phaseToFraction));
+        }
+
+        static void gatherPairs(const float* in, const int* pos, Type& x0, Type& x1)
+        {
+            gatherFourPairs(in, pos, x0, x1);
+        }
+
+        static void gatherQuads(const float* in, const int* pos, Type& xm1, Type& x0, Type& x1, Type& x2)
+        {
+            __m128 rows[4];
+            gatherFourQuads(in, pos, rows);
+
+            xm1 = rows[0];
+            x0 = rows[1];
+            x1 = rows[2];
+            x2 = rows[3];
+        }
+       #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        using Type = float32x4_t;
+        using Fractions = uint32x4_t;
+        static constexpr int size = 4;
+        static constexpr const char* name = "NEON";
+
+        static Type expand(float value)         { return vdupq_n_f32(value); }
+        static Type load(const float* p)        { return vld1q_f32(p); }
+        static void store(float* p, Type v)     { vst1q_f32(p, v); }
+        static Type add(Type a, Type b)         { return vaddq_f32(a, b); }
+        static Type sub(Type a, Type b)         { return vsubq_f32(a, b); }
+        static Type mul(Type a, Type b)         { return vmulq_f32(a, b); }
+
+        //flips each half, then swaps them
+        static Type reverse(Type v)
+        {
+            v = vrev64q_f32(v);
+            return vcombine_f32(vget_high_f32(v), vget_low_f32(v));
+        }
+
+        static Fractions loadFractions(const juce::uint32* f)    { return vld1q_u32(f); }
+        static Fractions addFractions(Fractions f, juce::uint32 step) { return vaddq_u32(f, vdupq_n_u32(step)); }
+        static Type toAlpha(Fractions f)        { return vmulq_n_f32(vcvtq_f32_u32(f), phaseToFraction); }
+
+        //each position's pair is loaded side by side, then unzipped
+        static void gatherPairs(const float* in, const int* pos, Type& x0, Type& x1)
+        {
+            const auto pairs = vuzpq_f32(vcombine_f32(vld1_f32(in + pos[0]), vld1_f32(in + pos[1])),
+                                         vcombine_f32(vld1_f32(in + pos[2]), vld1_f32(in + pos[3])));
+            x0 = pairs.val[0];
+            x1 = pairs.val[1];
+        }
+
+        //a row of taps per position, transposed so each tap has it's own vector
+        static void gatherQuads(const float* in, const int* pos, Type& xm1, Type& x0, Type& x1, Type& x2)
+        {
+            const auto rows01 = vtrnq_f32(vld1q_f32(in + pos[0] - 1), vld1q_f32(in + pos[1] - 1));
+            const auto rows23 = vtrnq_f32(vld1q_f32(in + pos[2] - 1), vld1q_f32(in + pos[3] - 1));
+
+            xm1 = vcombine_f32(vget_low_f32(rows01.val[0]), vget_low_f32(rows23.val[0]));
+            x0 = vcombine_f32(vget_low_f32(rows01.val[1]), vget_low_f32(rows23.val[1]));
+            x1 = vcombine_f32(vget_high_f32(rows01.val[0]), vget_high_f32(rows23.val[0]));
+            x2 = vcombine_f32(vget_high_f32(rows01.val[1]), vget_high_f32(rows23.val[1]));
+        }
+       #else
+        using Type = float;
+        using Fractions = juce::uint32;
+        static constexpr int size = 1;
+        static constexpr const char* name = "scalar";
+
+        static Type expand(float value)         { return value; }
+        static Type load(const float* p)        { return *p; }
+        static void store(float* p, Type v)     { *p = v; }
+        static Type add(Type a, Type b)         { return a + b; }
+        static Type sub(Type a, Type b)         { return a - b; }
+        static Type mul(Type a, Type b)         { return a * b; }
+        static Type reverse(Type v)             { return v; }
+
+        static Fractions loadFractions(const juce::uint32* f)    { return *f; }
+        static Fractions addFractions(Fractions f, juce::uint32 step) { return f + step; }
+        static Type toAlpha(Fractions f)        { return (float)f * phaseToFraction; }
+
+        static void gatherPairs(const float* in, const int* pos, Type& x0, Type& x1)
+        {
+            x0 = in[pos[0]];
+            x1 = in[pos[0] + 1];
+        }
+
+        static void gatherQuads(const float* in, const int* pos, Type& xm1, Type& x0, Type& x1, Type& x2)
+        {
+            xm1 = in[pos[0] - 1];
+            x0 = in[pos[0]];
+            x1 = in[pos[0] + 1];
+            x2 = in[pos[0] + 2];
+        }
+       #endif
+
+    private:
+       #if JUCE_INTEL
+        //the pairs of 4 positions loaded 2 to a vector, then split into the first and second of each pair
+        static void gatherFourPairs(const float* in, const int* pos, __m128& x0, __m128& x1)
+        {
+            const auto first = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(in + pos[0])),
+                                            reinterpret_cast<const __m64*>(in + pos[1]));
+            const auto second = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(in + pos[2])),
+                                             reinterpret_cast<const __m64*>(in + pos[3]));
+
+            x0 = _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0));
+            x1 = _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1));
+        }
+
+        //a row of taps per position, transposed so each tap has it's own vector
+        static void gatherFourQuads(const float* in, const int* pos, __m128* taps)
+        {
+            taps[0] = _mm_loadu_ps(in + pos[0] - 1);
+            taps[1] = _mm_loadu_ps(in + pos[1] - 1);
+            taps[2] = _mm_loadu_ps(in + pos[2] - 1);
+            taps[3] = _mm_loadu_ps(in + pos[3] - 1);
+
+            _MM_TRANSPOSE4_PS(taps[0], taps[1], taps[2], taps[3]);
+        }
+       #endif
+    };
+
+    //reads one channel between in[pos] and in[pos + 1], alpha is how far along it is
+    template <int Interp>
+    inline float interpolate(const float* in, int pos, float alpha, const SincTable* sincTable)
+    {
+        if constexpr (Interp == hermite)
+        {
+            const float xm1 = in[pos - 1], x0 = in[pos], x1 = in[pos + 1], x2 = in[pos + 2];
+
+            const float c1 = 0.5f * (x1 - xm1);
+            const float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+            const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+
+            return ((c3 * alpha + c2) * alpha + c1) * alpha + x0;
+        }
+        else if constexpr (Interp == sinc)
+        {
+            return sincTable->interpolate(in, pos, alpha);
+        }
+        else
+        {
+            return in[pos] * (1.0f - alpha) + in[pos + 1] * alpha;
+        }
+    }
+
+    //interpolate() for SimdFloats::size positions at once, the same sums in the same order
+    template <int Interp>
+    inline SimdFloats::Type interpolateVector(const float* in, const int* pos, SimdFloats::Type alpha)
+    {
+        using V = SimdFloats;
+
+        if constexpr (Interp == hermite)
+        {
+            V::Type xm1, x0, x1, x2;
+            V::gatherQuads(in, pos, xm1, x0, x1, x2);
+
+            const auto half = V::expand(0.5f);
+
+            const auto c1 = V::mul(half, V::sub(x1, xm1));
+            const auto c2 = V::sub(V::add(V::sub(xm1, V::mul(V::expand(2.5f), x0)), V::mul(V::expand(2.0f), x1)), V::mul(half, x2));
+            const auto c3 = V::add(V::mul(half, V::sub(x2, xm1)), V::mul(V::expand(1.5f), V::sub(x0, x1)));
+
+            return V::add(V::mul(V::add(V::mul(V::add(V::mul(c3, alpha), c2), alpha), c1), alpha), x0);
+        }
+        else
+        {
+            V::Type x0, x1;
+            V::gatherPairs(in, pos, x0, x1);
+
+            return V::add(V::mul(x0, V::sub(V::expand(1.0f), alpha)), V::mul(x1, alpha));
+        }
+    }
+
+    //The sample that moves the position out of the bounds is still rendered (same as the old loop). The number of samples left is
+    //worked out up front, so the loop has a fixed trip count and no exit test, and each position is worked out from the start of the chunk.
+    //The vector version does the linear and hermite reads SimdFloats::size samples at a time, the leftovers and the sinc reads go through the scalar loop
+    template <bool Vector, bool Reverse, bool StereoSource, int Interp, bool Enveloped>
+    inline int readResampled(VoiceRenderState& s, const float* envelope, float* scratchL, float* scratchR, int numSamples)
+    {
+        const float* const inL = s.inL;
+        const float* const inR = s.inR;
+        const SincTable* const sincTable = s.sincTable;
+        const juce::int64 increment = Reverse ? -s.increment : s.increment;
+        const juce::int64 position = s.position;
+
+        //the first sample is always rendered, after that it's every step that lands inside the bounds
+        juce::int64 numLeft = numSamples;
+        if (s.increment > 0)
+        {
+            const juce::int64 next = position + increment;
+
+            if (next > s.upperBound || next < s.lowerBound)
+            {
+                numLeft = 1;
+            }
+            else
+            {
+                numLeft = (Reverse ? position - s.lowerBound : s.upperBound - position) / s.increment + 1;
+            }
+        }
+
+        const int num = (int)juce::jmin((juce::int64)numSamples, numLeft);
+        int i = 0;
+
+        if constexpr (Vector && Interp != sinc && SimdFloats::size > 1)
+        {
+            using V = SimdFloats;
+
+            //the low 32 bits of each lane's phase, they only need 32 bit adds to step
+            juce::uint32 firstFractions[V::size];
+            for (int j = 0; j < V::size; j++)
+            {
+                firstFractions[j] = (juce::uint32)(position + increment * j);
+            }
+
+            auto fractions = V::loadFractions(firstFractions);
+            const auto fractionStep = (juce::uint32)(increment * V::size);
+
+            for (; i + V::size <= num; i += V::size)
+            {
+                int pos[V::size];
+                juce::int64 p = position + increment * i;
+
+                for (int j = 0; j < V::size; j++, p += increment)
+                {
+                    pos[j] = (int)(p >> phaseFractionBits);
+                }
+
+                const auto alphas = V::toAlpha(fractions);
+                fractions = V::addFractions(fractions, fractionStep);
+
+                if constexpr (Enveloped)
+                {
+                    const auto levels = V::load(envelope + i);
+
+                    V::store(scratchL + i, V::mul(interpolateVector<Interp>(inL, pos, alphas), levels));
+                    if constexpr (StereoSource)
+                    {
+                        V::store(scratchR + i, V::mul(interpolateVector<Interp>(inR, pos, alphas), levels));
+                    }
+                }
+                else
+                {
+                    V::store(scratchL + i, interpolateVector<Interp>(inL, pos, alphas));
+                    if constexpr (StereoSource)
+                    {
+                        V::store(scratchR + i, interpolateVector<Interp>(inR, pos, alphas));
+                    }
+                }
+            }
+        }
+
+        for (; i < num; i++)
+        {
+            const juce::int64 p = position + increment * i;
+            const auto pos = (int)(p >> phaseFractionBits);
+            const auto alpha = (float)(juce::uint32)p * phaseToFraction;
+
+            const float level = Enveloped ? envelope[i] : 1.0f;
+
+            scratchL[i] = interpolate<Interp>(inL, pos, alpha, sincTable) * level;
+            if constexpr (StereoSource)
+            {
+                scratchR[i] = interpolate<Interp>(inR, pos, alpha, sincTable) * level;
+            }
+        }
+
+        s.position = position + increment * num;
+        return num;
+    }
+
+    //Unpitched at the host rate, the position is always a whole sample so we can work out up front how many samples are left.
+    //Forward with a flat envelope there's nothing to do to the samples, so srcL/srcR are pointed at the sample itself instead of the scratch buffers.
+    //The vector version reads backwards SimdFloats::size samples at a time, and flips them round
+    template <bool Vector, bool Reverse, bool StereoSource, bool Enveloped>
+    inline int readUnity(VoiceRenderState& s, const float* envelope, float* scratchL, float* scratchR,
+                         const float*& srcL, const float*& srcR, int numSamples)
+    {
+        const int pos = (int)(s.position >> phaseFractionBits);
+
+        //the first sample is always rendered, even if the note starts out of bounds
+        int numLeft = 1;
+        if (!(Reverse && s.position > s.upperBound))
+        {
+            numLeft = juce::jmax(1, Reverse ? (int)((s.position - s.lowerBound) >> phaseFractionBits) + 1
+                                            : (int)((s.upperBound - s.position) >> phaseFractionBits) + 1);
+        }
+
+        const int num = juce::jmin(numSamples, numLeft);
+
+        if constexpr (Reverse)
+        {
+            int i = 0;
+
+            if constexpr (Vector && SimdFloats::size > 1)
+            {
+                using V = SimdFloats;
+
+                for (; i + V::size <= num; i += V::size)
+                {
+                    //the lowest of the samples, the last one played
+                    const int lowest = pos - i - (V::size - 1);
+
+                    if constexpr (Enveloped)
+                    {
+                        const auto levels = V::load(envelope + i);
+
+                        V::store(scratchL + i, V::mul(V::reverse(V::load(s.inL + lowest)), levels));
+                        if constexpr (StereoSource)
+                        {
+                            V::store(scratchR + i, V::mul(V::reverse(V::load(s.inR + lowest)), levels));
+                        }
+                    }
+                    else
+                    {
+                        V::store(scratchL + i, V::reverse(V::load(s.inL + lowest)));
+                        if constexpr (StereoSource)
+                        {
+                            V::store(scratchR + i, V::reverse(V::load(s.inR + lowest)));
+                        }
+                    }
+                }
+            }
+
+            for (; i < num; i++)
+            {
+                const float level = Enveloped ? envelope[i] : 1.0f;
+
+                scratchL[i] = s.inL[pos - i] * level;
+                if constexpr (StereoSource)
+                {
+                    scratchR[i] = s.inR[pos - i] * level;
+                }
+            }
+
+            s.position -= (juce::int64)num << phaseFractionBits;
+        }
+        else if constexpr (Enveloped)
+        {
+            juce::FloatVectorOperations::multiply(scratchL, s.inL + pos, envelope, num);
+            if constexpr (StereoSource)
+            {
+                juce::FloatVectorOperations::multiply(scratchR, s.inR + pos, envelope, num);
+            }
+
+            s.position += (juce::int64)num << phaseFractionBits;
+        }
+        else
+        {
+            srcL = s.inL + pos;
+            srcR = StereoSource ? s.inR + pos : nullptr;
+
+            s.position += (juce::int64)num << phaseFractionBits;
+        }
+
+        return num;
+    }
+
+    template <bool Vector, bool Reverse, bool StereoSource, int Interp, bool Enveloped>
+    inline int read(VoiceRenderState& s, const float* envelope, float* scratchL, float* scratchR,
+                    const float*& srcL, const float*& srcR, int numSamples)
+    {
+        if constexpr (Interp == none)
+        {
+            return readUnity<Vector, Reverse, StereoSource, Enveloped>(s, envelope, scratchL, scratchR, srcL, srcR, numSamples);
+        }
+        else
+        {
+            return readResampled<Vector, Reverse, StereoSource, Interp, Enveloped>(s, envelope, scratchL, scratchR, numSamples);
+        }
+    }
+
+    //level is the flat envelope level, or 1.0 when the envelope was already applied in the read pass
+    template <bool StereoSource, bool StereoOutput>
+    inline void mix(const VoiceRenderState& s, float* outL, float* outR, const float* srcL, const float* srcR, float level, int numSamples)
+    {
+        if constexpr (!StereoSource)
+        {
+            srcR = srcL;
+        }
+
+        if constexpr (StereoOutput)
+        {
+            juce::FloatVectorOperations::addWithMultiply(outL, srcL, s.gainL * level, numSamples);
+            juce::FloatVectorOperations::addWithMultiply(outR, srcR, s.gainR * level, numSamples);
+        }
+        else if constexpr (StereoSource)
+        {
+            //mono output, both sides are summed at half gain
+            juce::FloatVectorOperations::addWithMultiply(outL, srcL, s.gainL * level * 0.5f, numSamples);
+            juce::FloatVectorOperations::addWithMultiply(outL, srcR, s.gainR * level * 0.5f, numSamples);
+        }
+        else
+        {
+            juce::FloatVectorOperations::addWithMultiply(outL, srcL, (s.gainL + s.gainR) * 0.5f * level, numSamples);
+        }
+    }
+
+    template <bool Vector, bool Reverse, bool StereoSource, bool StereoOutput, int Interp>
+    int renderChunk(VoiceRenderState& s, float* outL, float* outR, const float* envelope, float envelopeLevel,
+                    float* scratchL, float* scratchR, int numSamples)
+    {
+        const float* srcL = scratchL;
+        const float* srcR = scratchR;
+
+        int numRendered = 0;
+
+        if (envelope != nullptr)
+        {
+            numRendered = read<Vector, Reverse, StereoSource, Interp, true>(s, envelope, scratchL, scratchR, srcL, srcR, numSamples);
+            envelopeLevel = 1.0f;
+        }
+        else
+        {
+            numRendered = read<Vector, Reverse, StereoSource, Interp, false>(s, nullptr, scratchL, scratchR, srcL, srcR, numSamples);
+        }
+
+        mix<StereoSource, StereoOutput>(s, outL, outR, srcL, srcR, envelopeLevel, numRendered);
+        return numRendered;
+    }
+
+    //one entry per combination, the index is laid out as (reverse, stereo source, stereo output, interpolation) from the top bit down
+    template <bool Vector, size_t... Index>
+    constexpr std::array<RenderKernel, sizeof...(Index)> makeKernelTable(std::index_sequence<Index...>)
+    {
+        return { { renderChunk<Vector,
+                               ((Index / (numInterpolations * 4)) & 1) != 0,
+                               ((Index / (numInterpolations * 2)) & 1) != 0,
+                               ((Index / numInterpolations) & 1) != 0,
+                               (int)(Index % numInterpolations)>... } };
+    }
+
+    inline int getKernelIndex(bool reverse, bool stereoSource, bool stereoOutput, Interpolation interpolation)
+    {
+        return ((reverse ? 4 : 0) + (stereoSource ? 2 : 0) + (stereoOutput ? 1 : 0)) * numInterpolations
+               + juce::jlimit(0, numInterpolations - 1, (int)interpolation);
+    }
+
+    //pass none for notes that play unpitched at the host rate
+    inline RenderKernel getKernel(bool reverse, bool stereoSource, bool stereoOutput, Interpolation interpolation)
+    {
+        static constexpr auto kernels = makeKernelTable<true>(std::make_index_sequence<numInterpolations * 8>());
+        return kernels[(size_t)getKernelIndex(reverse, stereoSource, stereoOutput, interpolation)];
+    }
+
+    //the same kernels without the SimdFloats paths, for the tests and benchmarks to check the vector ones against
+    inline RenderKernel getScalarKernel(bool reverse, bool stereoSource, bool stereoOutput, Interpolation interpolation)
+    {
+        static constexpr auto kernels = makeKernelTable<false>(std::make_index_sequence<numInterpolations * 8>());
+        return kernels[(size_t)getKernelIndex(reverse, stereoSource, stereoOutput, interpolation)];
+    }
+}
@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    KrumResampler.cpp
+    Created: 17 Oct 2026 2:41:18pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumResampler.h"
+
+//zeroth order modified bessel function, for the kaiser window
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    double halfX = x * 0.5;
+
+    for (int k = 1; k < 64; k++)
+    {
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+
+        if (term < sum * 1.0e-12)
+        {
+            break;
+        }
+    }
+
+    return sum;
+}
+
+SincTable::SincTable(int zeroCrossings, int phases, double cutoff, double kaiserBeta)
+    : numZeroCrossings(zeroCrossings), numTaps(zeroCrossings * 2), numPhases(phases)
+{
+    coefficients.resize((size_t)((numPhases + 1) * numTaps));
+
+    const double i0Beta = besselI0(kaiserBeta);
+
+    for (int phase = 0; phase <= numPhases; phase++)
+    {
+        float* row = coefficients.data() + phase * numTaps;
+        double fraction = (double)phase / numPhases;
+        double sum = 0;
+
+        for (int i = 0; i < numTaps; i++)
+        {
+            //distance of this tap from the read position, in input samples
+            double t = (i - numZeroCrossings + 1) - fraction;
+            double x = t / numZeroCrossings;
+
+            double window = std::abs(x) < 1.0 ? besselI0(kaiserBeta * std::sqrt(1.0 - x * x)) / i0Beta : 0.0;
+            double sinc = t == 0.0 ? 1.0 : std::sin(juce::MathConstants<double>::pi * cutoff * t) / (juce::MathConstants<double>::pi * cutoff * t);
+
+            double coefficient = cutoff * sinc * window;
+            row[i] = (float)coefficient;
+            sum += coefficient;
+        }
+
+        //every phase gets unity gain at DC, otherwise you can hear the gain wobble as the phase moves
+        for (int i = 0; i < numTaps; i++)
+        {
+            row[i] = (float)(row[i] / sum);
+        }
+    }
+}
+
+//==================================================================================================//
+
+int KrumResampler::getConvertedLength(int sourceLength, double sourceRate, double targetRate)
+{
+    return (int)std::ceil(sourceLength * targetRate / sourceRate);
+}
+
+void KrumResampler::convertSampleRate(const float* const* source, float* const* dest, int numChannels, int sourceLength,
+                                      double sourceRate, double targetRate)
+{
+    //input samples per output sample
+    const double ratio = sourceRate / targetRate;
+    const int destLength = getConvertedLength(sourceLength, sourceRate, targetRate);
+
+    //when converting down, the cutoff follows the new nyquist
+    SincTable table(32, 512, juce::jmin(1.0, targetRate / sourceRate) * 0.95);
+    const int padding = table.getNumZeroCrossings();
+
+    //a copy with silence on both ends so the filter can read past the start and end of the sample
+    std::vector<float> padded((size_t)(sourceLength + padding * 2), 0.0f);
+
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        std::copy(source[channel], source[channel] + sourceLength, padded.begin() + padding);
+
+        const float* in = padded.data() + padding;
+        float* out = dest[channel];
+
+        for (int i = 0; i < destLength; i++)
+        {
+            double position = i * ratio;
+            int index = (int)position;
+            out[i] = table.interpolate(in, index, (float)(position - index));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------------------
+
+namespace
+{
+    //band 0 is anything up to unity, after that each band covers half an octave more of pitching up
+    constexpr int numPlaybackBands = 8;
+
+    struct PlaybackSincTables
+    {
+        PlaybackSincTables()
+        {
+            for (int band = 0; band < numPlaybackBands; band++)
+            {
+                double cutoff = 0.9 / std::pow(2.0, band * 0.5);
+                tables[band] = std::make_unique<SincTable>(KrumResampler::playbackZeroCrossings, 256, cutoff);
+            }
+        }
+
+        std::unique_ptr<SincTable> tables[numPlaybackBands];
+    };
+
+    const PlaybackSincTables& getPlaybackSincTables()
+    {
+        static const PlaybackSincTables tables;
+        return tables;
+    }
+}
+
+const SincTable& KrumResampler::getPlaybackSincTable(double increment)
+{
+    int band = increment > 1.0 ? (int)std::ceil(std::log2(increment) * 2.0) : 0;
+    return *getPlaybackSincTables().tables[juce::jlimit(0, numPlaybackBands - 1, band)];
+}
+
+void KrumResampler::prepareTables()
+{
+    getPlaybackSincTables();
+}
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    KrumResampler.h
+    Created: 17 Oct 2026 2:41:18pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+/*
+*
+* Windowed sinc resampling.
+*
+* SincTable holds a Kaiser windowed sinc cut into numPhases fractional positions (plus one extra so we can always interpolate between two phases).
+* Each phase is stored as one row of numTaps floats, so working out one output sample reads two short contiguous rows and the input, nothing else.
+*
+* convertSampleRate() uses a table to make a copy of a whole sample at a new rate. The sounds keep one of these at the host rate,
+* see KrumSound, so an unpitched sample is just a copy on the audio thread.
+*
+* The voices use the shorter playback tables for the sinc interpolation mode, see getPlaybackSincTable(). There is one table per
+* band of playback ratios, so pitching a sample up lowers the cutoff with it instead of folding the top end back down.
+*
+*/
+
+class SincTable
+{
+public:
+    //cutoff is relative to the nyquist of the input, 1.0 passes everything, lower it when converting down so nothing folds back
+    SincTable(int numZeroCrossings, int numPhases, double cutoff, double kaiserBeta = 8.0);
+
+    int getNumZeroCrossings() const { return numZeroCrossings; }
+    int getNumTaps() const { return numTaps; }
+    int getNumPhases() const { return numPhases; }
+
+    //input must be readable from [index - numZeroCrossings + 1] to [index + numZeroCrossings]
+    inline float interpolate(const float* input, int index, float fraction) const
+    {
+        float phasePosition = fraction * numPhases;
+        int phase = juce::jmin((int)phasePosition, numPhases - 1); //a fraction just under 1 can round up to 1 as a float
+        float alpha = phasePosition - phase;
+
+        const float* c0 = coefficients.data() + phase * numTaps;
+        const float* c1 = c0 + numTaps;
+        const float* in = input + index - numZeroCrossings + 1;
+
+        float s0 = 0, s1 = 0;
+        for (int i = 0; i < numTaps; i++)
+        {
+            s0 += in[i] * c0[i];
+            s1 += in[i] * c1[i];
+        }
+
+        return s0 + alpha * (s1 - s0);
+    }
+
+private:
+    int numZeroCrossings, numTaps, numPhases;
+    std::vector<float> coefficients;
+
+    JUCE_DECLARE_NON_COPYABLE(SincTable)
+};
+
+namespace KrumResampler
+{
+    //the playback tables read this many samples either side of the position
+    constexpr int playbackZeroCrossings = 8;
+
+    //number of samples sourceLength samples at sourceRate come to at targetRate
+    int getConvertedLength(int sourceLength, double sourceRate, double targetRate);
+
+    //Converts sourceLength samples of each source channel to targetRate, writing getConvertedLength() samples to each dest channel.
+    //Slow, call this off the audio thread.
+    void convertSampleRate(const float* const* source, float* const* dest, int numChannels, int sourceLength,
+                           double sourceRate, double targetRate);
+
+    //The table for a voice reading the input at this many input samples per output sample. Safe to call on the audio thread,
+    //the tables are all built the first time any of them are asked for, see prepareTables().
+    const SincTable& getPlaybackSincTable(double increment);
+
+    //builds the playback tables, call this once off the audio thread before any voice needs them
+    void prepareTables();
+}
@@ -0,0 +1,437 @@
+/*
+  ==============================================================================
+
+    KrumSampleData.cpp
+    Created: 17 Oct 2026 9:12:40pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumSampleData.h"
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+ #include <arm_neon.h>
+#endif
+
+void KrumSampleMetadata::startAnalysis(int totalLength)
+{
+    const int numBlocks = juce::jmax(1, (totalLength + peakBlockSize - 1) / peakBlockSize);
+
+    //nothing audible found yet
+    firstAudibleSample = totalLength;
+    lastAudibleSample = -1;
+    numAnalysed = 0;
+
+    peaksToStart.clear();
+    peaksToEnd.assign((size_t)numBlocks, 0.0f);
+}
+
+void KrumSampleMetadata::analyseBlock(const float* const* channels, int numChannels, int numSamples)
+{
+    auto isAudible = [channels, numChannels](int i)
+    {
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            if (std::abs(channels[channel][i]) > silenceThresholdGain)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    };
+
+    //split at the peak blocks, the block peaks are built up in peaksToEnd until finishAnalysis()
+    for (int i = 0; i < numSamples;)
+    {
+        const int position = numAnalysed + i;
+        const int block = position / peakBlockSize;
+        const int num = juce::jmin(numSamples - i, (block + 1) * peakBlockSize - position);
+
+        float peak = 0.0f;
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            float minValue = 0, maxValue = 0;
+            juce::FloatVectorOperations::findMinAndMax(channels[channel] + i, num, minValue, maxValue);
+            peak = juce::jmax(peak, std::abs(minValue), std::abs(maxValue));
+        }
+
+        if (juce::isPositiveAndBelow(block, (int)peaksToEnd.size()))
+        {
+            peaksToEnd[(size_t)block] = juce::jmax(peaksToEnd[(size_t)block], peak);
+        }
+
+        //only the stretches with something audible in them are looked at sample by sample
+        if (peak > silenceThresholdGain)
+        {
+            if (lastAudibleSample < 0)
+            {
+                int first = i;
+                while (!isAudible(first))
+                {
+                    ++first;
+                }
+
+                firstAudibleSample = numAnalysed + first;
+            }
+
+            int last = i + num - 1;
+            while (!isAudible(last))
+            {
+                --last;
+            }
+
+            lastAudibleSample = numAnalysed + last;
+        }
+
+        i += num;
+    }
+
+    numAnalysed += numSamples;
+}
+
+void KrumSampleMetadata::finishAnalysis()
+{
+    const size_t numBlocks = peaksToEnd.size();
+    peaksToStart = peaksToEnd;
+
+    for (size_t block = 1; block < numBlocks; block++)
+    {
+        peaksToStart[block] = juce::jmax(peaksToStart[block], peaksToStart[block - 1]);
+    }
+
+    for (size_t block = numBlocks - 1; block-- > 0;)
+    {
+        peaksToEnd[block] = juce::jmax(peaksToEnd[block], peaksToEnd[block + 1]);
+    }
+}
+
+float KrumSampleMetadata::getPeakToEnd(int position) const
+{
+    return peaksToEnd[(size_t)juce::jlimit(0, (int)peaksToEnd.size() - 1, position / peakBlockSize)];
+}
+
+float KrumSampleMetadata::getPeakToStart(int position) const
+{
+    return peaksToStart[(size_t)juce::jlimit(0, (int)peaksToStart.size() - 1, position / peakBlockSize)];
+}
+
+//==================================================================================================//
+
+void KrumSampleData::read(juce::AudioFormatReader& reader, int numSamples)
+{
+    sampleRate = reader.sampleRate;
+    allocate(juce::jmin(2, (int)reader.numChannels), numSamples);
+    reader.read(&buffer, padding, numSamples + padding, 0, true, true);
+}
+
+void KrumSampleData::pin()
+{
+    //the channels aren't always one block, so each one is pinned on it's own
+    for (int channel = 0; channel < juce::jmin(2, getNumChannels()); channel++)
+    {
+        pinnedChannels[channel].pin(buffer.getReadPointer(channel), (size_t)buffer.getNumSamples() * sizeof(float));
+    }
+}
+
+void KrumSampleData::unpin()
+{
+    for (auto& pinned : pinnedChannels)
+    {
+        pinned.unpin();
+    }
+}
+
+void KrumSampleData::analyse()
+{
+    const float* channels[2] = { nullptr, nullptr };
+    const int numChannels = juce::jmin(2, getNumChannels());
+
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        channels[channel] = getReadPointer(channel);
+    }
+
+    startAnalysis(length);
+    analyseBlock(channels, numChannels, length);
+    finishAnalysis();
+}
+
+//==================================================================================================//
+
+//The reader hands back integer samples left justified in 32 bits, a packed sample is just the top bytes of that.
+//So the bits that are dropped are always 0, and unpacking scales the same way the reader does for it's floats.
+template <int numBytes>
+static void packSample(juce::int32 sample, juce::uint8* bytes)
+{
+    for (int i = 0; i < numBytes; i++)
+    {
+        bytes[i] = (juce::uint8)((juce::uint32)sample >> (8 * (4 - numBytes + i)));
+    }
+}
+
+template <int numBytes>
+static float unpackSample(const juce::uint8* bytes)
+{
+    juce::uint32 sample = 0;
+    for (int i = 0; i < numBytes; i++)
+    {
+        sample |= (juce::uint32)bytes[i] << (8 * (4 - numBytes + i));
+    }
+
+    return (float)(juce::int32)sample * (1.0f / 2147483648.0f);
+}
+
+template <int numBytes>
+static void unpackSamples(const juce::uint8* first, int sampleStride, bool reverse, float* out, int numSamples)
+{
+    const juce::int64 step = reverse ? -sampleStride : sampleStride;
+
+    for (int i = 0; i < numSamples; i++)
+    {
+        out[i] = unpackSample<numBytes>(first + i * step);
+    }
+}
+
+//A 16 bit sample in the top half of a 32 bit int converts to exactly the float unpackSample() gives, so the vector versions below do 4 at a time
+//that way. They handle samples one after the other (packed, or a mapped mono file) and every other one (a channel of a mapped stereo file).
+//The reads never go past the last sample, a mapped file can end right there
+#if JUCE_INTEL
+static inline __m128 unpackFour16(const juce::uint8* lowest, int sampleStride)
+{
+    __m128i ints;
+
+    if (sampleStride == 2)
+    {
+        ints = _mm_unpacklo_epi16(_mm_setzero_si128(), _mm_loadl_epi64(reinterpret_cast<const __m128i*>(lowest)));
+    }
+    else
+    {
+        //the first read has samples 0 and 1 in the bottom halves of it's ints, the second starts 6 bytes in so 2 and 3 are in the top halves
+        const __m128i low = _mm_slli_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(lowest)), 16);
+        const __m128i high = _mm_and_si128(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(lowest + 6)), _mm_set1_epi32((int)0xffff0000));
+        ints = _mm_unpacklo_epi64(low, high);
+    }
+
+    return _mm_mul_ps(_mm_cvtepi32_ps(ints), _mm_set1_ps(1.0f / 2147483648.0f));
+}
+
+static inline void storeFour(float* out, __m128 samples, bool reverse)
+{
+    _mm_storeu_ps(out, reverse ? _mm_shuffle_ps(samples, samples, _MM_SHUFFLE(0, 1, 2, 3)) : samples);
+}
+ #define KRUM_VECTOR_UNPACK 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+static inline float32x4_t unpackFour16(const juce::uint8* lowest, int sampleStride)
+{
+    int32x4_t ints;
+
+    if (sampleStride == 2)
+    {
+        ints = vshll_n_s16(vld1_s16(reinterpret_cast<const int16_t*>(lowest)), 16);
+    }
+    else
+    {
+        //see the SSE version
+        const int32x2_t low = vshl_n_s32(vreinterpret_s32_s16(vld1_s16(reinterpret_cast<const int16_t*>(lowest))), 16);
+        const int32x2_t high = vand_s32(vreinterpret_s32_s16(vld1_s16(reinterpret_cast<const int16_t*>(lowest + 6))), vdup_n_s32((int32_t)0xffff0000));
+        ints = vcombine_s32(low, high);
+    }
+
+    return vmulq_n_f32(vcvtq_f32_s32(ints), 1.0f / 2147483648.0f);
+}
+
+static inline void storeFour(float* out, float32x4_t samples, bool reverse)
+{
+    if (reverse)
+    {
+        samples = vrev64q_f32(samples);
+        samples = vcombine_f32(vget_high_f32(samples), vget_low_f32(samples));
+    }
+
+    vst1q_f32(out, samples);
+}
+ #define KRUM_VECTOR_UNPACK 1
+#endif
+
+static void unpackSamples16(const juce::uint8* first, int sampleStride, bool reverse, float* out, int numSamples)
+{
+    int i = 0;
+
+   #if KRUM_VECTOR_UNPACK
+    if (sampleStride == 2 || sampleStride == 4)
+    {
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            //going backwards the 4 samples start at the last one, and are flipped round once they're converted
+            const juce::uint8* lowest = reverse ? first - (juce::int64)(i + 3) * sampleStride : first + (juce::int64)i * sampleStride;
+            storeFour(out + i, unpackFour16(lowest, sampleStride), reverse);
+        }
+    }
+   #endif
+
+    const juce::int64 step = reverse ? -sampleStride : sampleStride;
+    unpackSamples<2>(first + i * step, sampleStride, reverse, out + i, numSamples - i);
+}
+
+//The mapped readers keep where the samples are in the mapping to themselves, this borrows the access. It's never made
+struct MappedSampleAccess : public juce::MemoryMappedAudioFormatReader
+{
+    static const juce::uint8* getFirstSample(const juce::MemoryMappedAudioFormatReader& reader)
+    {
+        return static_cast<const juce::uint8*>((reader.*(&MappedSampleAccess::sampleToPointer))(0));
+    }
+
+    static int getBytesPerFrame(const juce::MemoryMappedAudioFormatReader& reader)
+    {
+        return reader.*(&MappedSampleAccess::bytesPerFrame);
+    }
+};
+
+int KrumPackedSampleData::getBytesPerSample(const juce::AudioFormatReader& reader)
+{
+    if (reader.usesFloatingPointData || reader.bitsPerSample == 0 || reader.bitsPerSample > 24)
+    {
+        return 0;
+    }
+
+    return reader.bitsPerSample <= 16 ? 2 : 3;
+}
+
+void KrumPackedSampleData::read(juce::AudioFormatReader& reader, int numSamples)
+{
+    jassert(getBytesPerSample(reader) > 0);
+
+    sampleRate = reader.sampleRate;
+    length = numSamples;
+    numChannels = juce::jmin(2, (int)reader.numChannels);
+    bytesPerSample = getBytesPerSample(reader);
+    data.malloc((size_t)juce::jmax((juce::int64)1, getSizeInBytes()));
+
+    samples = data;
+    channelStride = length * bytesPerSample;
+    sampleStride = bytesPerSample;
+
+    constexpr int readBlockSize = 65536;
+    juce::HeapBlock<int> intBlock((size_t)readBlockSize * 2);
+    int* intChannels[2] = { intBlock.get(), intBlock.get() + readBlockSize };
+
+    //the analysis works on floats, each block is converted for it as well
+    juce::AudioBuffer<float> floatBlock(numChannels, readBlockSize);
+
+    startAnalysis(length);
+
+    for (int position = 0; position < length; position += readBlockSize)
+    {
+        const int num = juce::jmin(readBlockSize, length - position);
+        reader.read(intChannels, numChannels, position, num, false);
+
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            juce::uint8* packed = data + ((juce::int64)channel * length + position) * bytesPerSample;
+
+            for (int i = 0; i < num; i++)
+            {
+                if (bytesPerSample == 2)
+                {
+                    packSample<2>(intChannels[channel][i], packed + i * 2);
+                }
+                else
+                {
+                    packSample<3>(intChannels[channel][i], packed + i * 3);
+                }
+            }
+
+            //same scaling as unpackSample(), so the metadata matches what the voices decode
+            juce::FloatVectorOperations::convertFixedToFloat(floatBlock.getWritePointer(channel), intChannels[channel], 1.0f / 2147483648.0f, num);
+        }
+
+        analyseBlock(floatBlock.getArrayOfReadPointers(), numChannels, num);
+    }
+
+    finishAnalysis();
+}
+
+bool KrumPackedSampleData::map(std::unique_ptr<juce::AudioFormatReader>& reader, int numSamples)
+{
+    auto* mapped = dynamic_cast<juce::MemoryMappedAudioFormatReader*>(reader.get());
+
+    //WAV keeps it's samples little endian and left justified, the same bytes read() packs them into. AIFF is big endian, 8 bit WAV is unsigned
+    //and anything in a wider frame than it's bits needs shifting, so those are all read() as normal
+    if (mapped == nullptr || reader->getFormatName() != "WAV file" || reader->usesFloatingPointData
+        || (reader->bitsPerSample != 16 && reader->bitsPerSample != 24))
+    {
+        return false;
+    }
+
+    const int numFileChannels = (int)reader->numChannels;
+    const int bytesPerFileSample = (int)reader->bitsPerSample / 8;
+    const auto mappedSection = mapped->getMappedSection();
+
+    if (MappedSampleAccess::getBytesPerFrame(*mapped) != numFileChannels * bytesPerFileSample
+        || mappedSection.getStart() > 0 || mappedSection.getEnd() < numSamples)
+    {
+        return false;
+    }
+
+    sampleRate = reader->sampleRate;
+    length = numSamples;
+    numChannels = juce::jmin(2, numFileChannels);
+    bytesPerSample = bytesPerFileSample;
+
+    samples = MappedSampleAccess::getFirstSample(*mapped);
+    channelStride = bytesPerSample;
+    sampleStride = numFileChannels * bytesPerSample;
+    mappedReader = std::move(reader);
+
+    //the metadata is worked out from the same decode the voices use, which touches every page of the samples on the way through
+    constexpr int analysisBlockSize = 65536;
+    juce::AudioBuffer<float> floatBlock(numChannels, analysisBlockSize);
+
+    startAnalysis(length);
+
+    for (int position = 0; position < length; position += analysisBlockSize)
+    {
+        const int num = juce::jmin(analysisBlockSize, length - position);
+
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            decode(channel, position, false, floatBlock.getWritePointer(channel), num);
+        }
+
+        analyseBlock(floatBlock.getArrayOfReadPointers(), numChannels, num);
+    }
+
+    finishAnalysis();
+    return true;
+}
+
+void KrumPackedSampleData::decode(int channel, juce::int64 position, bool reverse, float* out, int numSamples) const
+{
+    //the stretch that's inside the sample is converted in one go, either side of it is silence
+    const juce::int64 step = reverse ? -1 : 1;
+    const int firstInside = (int)juce::jlimit((juce::int64)0, (juce::int64)numSamples, reverse ? position - length + 1 : -position);
+    const int endInside = (int)juce::jlimit((juce::int64)firstInside, (juce::int64)numSamples, reverse ? position + 1 : length - position);
+
+    juce::FloatVectorOperations::clear(out, firstInside);
+    juce::FloatVectorOperations::clear(out + endInside, numSamples - endInside);
+
+    if (endInside == firstInside)
+    {
+        return;
+    }
+
+    const juce::uint8* first = samples + (juce::int64)channel * channelStride + (position + firstInside * step) * sampleStride;
+
+    if (bytesPerSample == 2)
+    {
+        unpackSamples16(first, sampleStride, reverse, out + firstInside, endInside - firstInside);
+    }
+    else
+    {
+        unpackSamples<3>(first, sampleStride, reverse, out + firstInside, endInside - firstInside);
+    }
+}
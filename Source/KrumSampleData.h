@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+    KrumSampleData.h
+    Created: 17 Oct 2026 9:12:40pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "KrumResampler.h"
+#include "KrumMemoryPinning.h"
+
+/*
+*
+* KrumSampleData is the decoded audio a sound plays, KrumSampleMetadata is what the voices know about it without looking at the audio itself.
+*
+* The metadata is kept on it's own so a streamed sample can have it for the whole file, while only the head of the file is in memory, see KrumStreamSource.
+* 
+* KrumPackedSampleData keeps a whole file as the 16 or 24 bit integers it was stored as, it takes a half or three quarters of the memory the floats would.
+* The sampler only packs a file when the floats won't fit the sample memory budget, see KrumSampler::reserveResidentMemory(). A 16 or 24 bit WAV
+* already has it's samples stored the way they'd be packed, so those are played straight out of the memory mapped file instead of being copied.
+*
+*/
+
+//The silence and peak metadata of a sample. It's worked out from the audio handed over in order, a block at a time,
+//call startAnalysis() first and finishAnalysis() after the last block.
+struct KrumSampleMetadata
+{
+    void startAnalysis(int totalLength);
+    void analyseBlock(const float* const* channels, int numChannels, int numSamples);
+    void finishAnalysis();
+
+    //the peak of every sample from position to the end (or the start, going backwards), rounded out to whole peak blocks
+    float getPeakToEnd(int position) const;
+    float getPeakToStart(int position) const;
+
+    //anything quieter than this is treated as silence, even with the clip gain all the way up it stays well under what can be heard
+    static constexpr float silenceThresholdGain = 0.000001f;   //-120dB
+    static constexpr int peakBlockSize = 256;
+
+    //the first and last samples louder than the silence threshold, the voices don't play the silence outside of them.
+    //lastAudibleSample is -1 if the whole thing is silent
+    int firstAudibleSample = 0;
+    int lastAudibleSample = -1;
+
+    //the peak of each peakBlockSize block of samples (all channels), carried forward from the start and back from the end
+    std::vector<float> peaksToStart;
+    std::vector<float> peaksToEnd;
+
+private:
+    int numAnalysed = 0;
+};
+
+//Audio a KrumSound plays from. Never changed once it's been handed to a sound, so sounds can share it.
+struct KrumSampleData : public juce::ReferenceCountedObject,
+                        public KrumSampleMetadata
+{
+    using Ptr = juce::ReferenceCountedObjectPtr<KrumSampleData>;
+
+    //samples kept before and after the audio, so the interpolators can read either side of any position without checking.
+    //It's silence, or for a baked region, the audio that was either side of it
+    static constexpr int padding = 16;
+
+    //sizes the buffer for numSamples plus the padding, and clears it
+    void allocate(int numChannels, int numSamples)
+    {
+        length = numSamples;
+        buffer.setSize(numChannels, numSamples + padding * 2);
+        buffer.clear();
+    }
+
+    //Decodes the first numSamples of the file straight into the buffer (up to 2 channels). The padding after the audio is whatever
+    //the reader gives back past them, the rest of the file, or silence past the end of it.
+    void read(juce::AudioFormatReader& reader, int numSamples);
+
+    int getNumChannels() const { return buffer.getNumChannels(); }
+
+    //these point at the first sample of the audio, the padding is at negative indexes
+    const float* getReadPointer(int channel) const { return buffer.getReadPointer(channel) + padding; }
+    float* getWritePointer(int channel) { return buffer.getWritePointer(channel) + padding; }
+
+    //Works out the metadata from the audio, call this once the audio is written and before the data is handed to a sound.
+    void analyse();
+
+    juce::int64 getSizeInBytes() const { return (juce::int64)buffer.getNumChannels() * buffer.getNumSamples() * (juce::int64)sizeof(float); }
+
+    //see KrumMemoryPinning, call these once the audio is written
+    void pin();
+    void unpin();
+
+    juce::AudioBuffer<float> buffer;
+    int length = 0;
+    double sampleRate = 0;
+
+private:
+    //after the buffer, so they're unlocked before it's freed
+    KrumPinnedBlock pinnedChannels[2];
+};
+
+//A whole sample packed as integers, 2 or 3 bytes a sample, one channel after the other, or interleaved in the file if it's mapped.
+//Never changed once it's been handed to a sound. The voices decode the stretch they're about to play into their own small buffer
+//and render from that, see KrumVoice::renderStagedChunk().
+struct KrumPackedSampleData : public juce::ReferenceCountedObject,
+                              public KrumSampleMetadata
+{
+    using Ptr = juce::ReferenceCountedObjectPtr<KrumPackedSampleData>;
+
+    //The bytes a sample of this reader's file takes up packed, 0 if it can't be packed without losing something (floating point, or more than 24 bits).
+    //A 2 byte sample holds anything up to 16 bits
+    static int getBytesPerSample(const juce::AudioFormatReader& reader);
+
+    //Reads the first numSamples of the file (up to 2 channels) a block at a time, packing it and working out the metadata as it goes.
+    //Only use this with a reader getBytesPerSample() says can be packed
+    void read(juce::AudioFormatReader& reader, int numSamples);
+
+    //Plays the first numSamples straight out of the reader's mapping instead of reading them, if it's a memory mapped 16 or 24 bit WAV (see
+    //KrumSampler::createMappedReader()). Takes the reader and touches every page of the samples so they're in memory before the first note.
+    //Anything else is left alone and this returns false, read() it instead
+    bool map(std::unique_ptr<juce::AudioFormatReader>& reader, int numSamples);
+
+    //Decodes numSamples of a channel, starting at position and going backwards through the sample if reverse is set. Anything outside the sample is silence.
+    //Safe on the audio thread
+    void decode(int channel, juce::int64 position, bool reverse, float* out, int numSamples) const;
+
+    int getNumChannels() const { return numChannels; }
+    int getBytesPerSample() const { return bytesPerSample; }
+    bool isMapped() const { return mappedReader != nullptr; }
+
+    juce::int64 getSizeInBytes() const { return (juce::int64)numChannels * length * bytesPerSample; }
+
+    //see KrumMemoryPinning
+    void pin() { pinnedData.pin(samples, (size_t)getSpanInBytes()); }
+    void unpin() { pinnedData.unpin(); }
+
+    int length = 0;
+    double sampleRate = 0;
+
+private:
+    //the bytes from the first sample to the end of the last, a mapped file's other channels are in there too
+    juce::int64 getSpanInBytes() const
+    {
+        return length > 0 ? (juce::int64)(numChannels - 1) * channelStride + (juce::int64)(length - 1) * sampleStride + bytesPerSample : 0;
+    }
+
+    juce::HeapBlock<juce::uint8> data;
+    std::unique_ptr<juce::AudioFormatReader> mappedReader;      //holds the mapping the samples are in, if they're mapped
+
+    //the first sample of the first channel, the bytes to the next channel's first sample, and from one sample to the next
+    const juce::uint8* samples = nullptr;
+    int channelStride = 0;
+    int sampleStride = 0;
+
+    int numChannels = 0;
+    int bytesPerSample = 0;
+
+    KrumPinnedBlock pinnedData;
+};
+
+static_assert(KrumSampleData::padding > KrumResampler::playbackZeroCrossings + 1, "the sinc interpolation reads past the padding");
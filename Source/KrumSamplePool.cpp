@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    KrumSamplePool.cpp
+    Created: 17 Oct 2026 11:02:18pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumSamplePool.h"
+
+KrumSamplePool::KrumSamplePool()
+{
+}
+
+KrumSamplePool::~KrumSamplePool()
+{
+    juce::Logger::writeToLog("Sample Pool Closed - Hits: " + juce::String(numHits.load()) + ", Misses: " + juce::String(numMisses.load()));
+}
+
+KrumSampleData::Ptr KrumSamplePool::findDecoded(const juce::File& file)
+{
+    return static_cast<KrumSampleData*>(find(file, decodedData).get());
+}
+
+KrumPackedSampleData::Ptr KrumSamplePool::findPacked(const juce::File& file)
+{
+    return static_cast<KrumPackedSampleData*>(find(file, packedData).get());
+}
+
+KrumSampleData::Ptr KrumSamplePool::getOrLoadDecoded(const juce::File& file, const std::function<KrumSampleData*()>& load)
+{
+    return static_cast<KrumSampleData*>(getOrLoad(file, decodedData, [&load]() -> juce::ReferenceCountedObject* { return load(); }).get());
+}
+
+KrumPackedSampleData::Ptr KrumSamplePool::getOrLoadPacked(const juce::File& file, const std::function<KrumPackedSampleData*()>& load)
+{
+    return static_cast<KrumPackedSampleData*>(getOrLoad(file, packedData, [&load]() -> juce::ReferenceCountedObject* { return load(); }).get());
+}
+
+juce::String KrumSamplePool::makeKey(const juce::File& file, DataType type)
+{
+    return file.getLinkedTarget().getFullPathName() + "|" + juce::String(file.getSize())
+        + "|" + juce::String(file.getLastModificationTime().toMilliseconds()) + "|" + juce::String((int)type);
+}
+
+KrumSamplePool::DataPtr KrumSamplePool::find(const juce::File& file, DataType type)
+{
+    const auto key = makeKey(file, type);
+    Entry::Ptr entry;
+
+    {
+        const juce::ScopedLock sl(entriesLock);
+        auto it = entries.find(key);
+        if (it == entries.end())
+        {
+            return nullptr;
+        }
+
+        entry = it->second;
+    }
+
+    //if it's still loading, it's left to getOrLoad() to wait for it
+    const juce::ScopedTryLock tl(entry->loadLock);
+    if (!tl.isLocked() || entry->data == nullptr)
+    {
+        return nullptr;
+    }
+
+    ++numHits;
+    DBG("Sample Pool Hit: " + file.getFileName());
+    return entry->data;
+}
+
+KrumSamplePool::DataPtr KrumSamplePool::getOrLoad(const juce::File& file, DataType type, const std::function<juce::ReferenceCountedObject*()>& load)
+{
+    const auto key = makeKey(file, type);
+    Entry::Ptr entry;
+
+    {
+        const juce::ScopedLock sl(entriesLock);
+        auto& existing = entries[key];
+        if (existing == nullptr)
+        {
+            existing = new Entry();
+        }
+
+        entry = existing;
+    }
+
+    //the entries lock isn't held while loading, so other files can be looked up and loaded at the same time
+    const juce::ScopedLock sl(entry->loadLock);
+
+    if (entry->data != nullptr)
+    {
+        ++numHits;
+        DBG("Sample Pool Hit: " + file.getFileName());
+    }
+    else
+    {
+        ++numMisses;
+        entry->data = load();
+    }
+
+    return entry->data;
+}
+
+void KrumSamplePool::releaseUnused()
+{
+    //they're let go of outside the lock, freeing a long sample can take a while
+    juce::Array<Entry::Ptr> unused;
+
+    {
+        const juce::ScopedLock sl(entriesLock);
+
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            auto& entry = it->second;
+
+            //an entry someone else is holding is being looked up or loaded, the data is only ours if nothing but the entry holds it
+            if (entry->getReferenceCount() == 1 && (entry->data == nullptr || entry->data->getReferenceCount() == 1))
+            {
+                unused.add(entry);
+                it = entries.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    if (!unused.isEmpty())
+    {
+        DBG("Sample Pool Released: " + juce::String(unused.size()) + ", Entries Left: " + juce::String(getNumEntries()));
+    }
+}
+
+int KrumSamplePool::getNumEntries() const
+{
+    const juce::ScopedLock sl(entriesLock);
+    return (int)entries.size();
+}
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    KrumSamplePool.h
+    Created: 17 Oct 2026 11:02:18pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "KrumSampleData.h"
+
+/*
+*
+* One KrumSamplePool is shared by every instance of the plugin in the process, same as the loader pool.
+*
+* It holds the decoded (or packed) files the sounds play, keyed by the file's real path, size and modification time.
+* When a module in any instance loads a file that another module already has, it gets the same data instead of decoding it again.
+* The data is never changed once it's in here, so it's safe to share, see KrumSampleData.
+*
+* The pool holds a reference to everything in it, releaseUnused() lets go of the data no sound is using anymore.
+*
+*/
+
+class KrumSamplePool
+{
+public:
+    KrumSamplePool();
+    ~KrumSamplePool();
+
+    //The data for the file if a sound already has it, nullptr if not. Only hits are counted, a file that isn't here yet isn't a miss until it's loaded
+    KrumSampleData::Ptr findDecoded(const juce::File& file);
+    KrumPackedSampleData::Ptr findPacked(const juce::File& file);
+
+    //Loader threads. Returns the data for the file, calling load() to make it if it isn't here yet. Loads of the same file wait for each other,
+    //so when a kit is restored in a pile of instances at once the file is still only read once.
+    KrumSampleData::Ptr getOrLoadDecoded(const juce::File& file, const std::function<KrumSampleData*()>& load);
+    KrumPackedSampleData::Ptr getOrLoadPacked(const juce::File& file, const std::function<KrumPackedSampleData*()>& load);
+
+    //Drops the data only the pool is holding on to. The data is freed on the calling thread, so keep this off the audio thread
+    void releaseUnused();
+
+    //since the pool was made, safe from any thread
+    juce::uint32 getNumHits() const { return numHits; }
+    juce::uint32 getNumMisses() const { return numMisses; }
+    int getNumEntries() const;
+
+private:
+    enum DataType
+    {
+        decodedData,
+        packedData,
+    };
+
+    using DataPtr = juce::ReferenceCountedObjectPtr<juce::ReferenceCountedObject>;
+
+    struct Entry : public juce::ReferenceCountedObject
+    {
+        using Ptr = juce::ReferenceCountedObjectPtr<Entry>;
+
+        //held while the data is being loaded, see getOrLoad()
+        juce::CriticalSection loadLock;
+        DataPtr data;
+    };
+
+    //the file's real path (links are followed), size and modification time, and what the data is
+    static juce::String makeKey(const juce::File& file, DataType type);
+
+    DataPtr find(const juce::File& file, DataType type);
+    DataPtr getOrLoad(const juce::File& file, DataType type, const std::function<juce::ReferenceCountedObject*()>& load);
+
+    juce::CriticalSection entriesLock;
+    std::map<juce::String, Entry::Ptr> entries;
+
+    std::atomic<juce::uint32> numHits { 0 };
+    std::atomic<juce::uint32> numMisses { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(KrumSamplePool)
+};
@@ -15,37 +15,261 @@
 
 KrumSound::KrumSound    (KrumModule* pModule, 
                         const juce::String& soundName,
-                        juce::AudioFormatReader& source,
-                        const juce::BigInteger& notes,
-                        int midiNoteForNormalPitch,
+                        KrumSampleData* decodedFile,
+                        int note,
+                        int channel,
                         double attackTimeSecs,
                         double releaseTimeSecs,
-                        double maxSampleLengthSeconds)
-    : parentModule(pModule), name(soundName), sourceSampleRate(source.sampleRate), midiNotes(notes),midiRootNote(midiNoteForNormalPitch),
-        SamplerSound(soundName, source, notes, midiNoteForNormalPitch, attackTimeSecs, releaseTimeSecs, maxSampleLengthSeconds)
+                        double playbackSampleRate)
+    : KrumSamplerSound(moduleSound), name(soundName), source(decodedFile), midiNote(note), midiChannel(channel), parentModule(pModule)
 {
-    if (sourceSampleRate > 0 && source.lengthInSamples > 0)
+    if (source->length > 0)
     {
-        length = juce::jmin((int)source.lengthInSamples,
-            (int)(maxSampleLengthSeconds * sourceSampleRate));
-
-        data.reset(new juce::AudioBuffer<float>(juce::jmin(2, (int)source.numChannels), length + 4));
-
-        source.read(data.get(), 0, length + 4, 0, true, true);
-
         params.attack = static_cast<float> (attackTimeSecs);
         params.release = static_cast<float> (releaseTimeSecs);
     }
 
+    preparePlaybackData(playbackSampleRate);
+
     DBG("I'm Alive: " + name);
 
 }
 
+KrumSampleData* KrumSound::decodeFile(juce::AudioFormatReader& reader, double maxSampleLengthSeconds)
+{
+    auto* data = new KrumSampleData();
+    data->sampleRate = reader.sampleRate;
+    data->allocate(1, 0); //silence, in case the reader has nothing for us
+
+    if (reader.sampleRate > 0 && reader.lengthInSamples > 0)
+    {
+        data->read(reader, (int)juce::jmin(reader.lengthInSamples, (juce::int64)(maxSampleLengthSeconds * reader.sampleRate)));
+        data->analyse();
+    }
+
+    return data;
+}
+
+KrumSound::KrumSound(const KrumSound& other, double playbackSampleRate, const BakeSettings& settings)
+    : KrumSamplerSound(moduleSound), name(other.name), 
+    sourceFile(other.sourceFile), sourceFileModificationTime(other.sourceFileModificationTime),
+    source(other.source), midiNote(other.getMidiNote()), midiChannel(other.midiChannel.load()), params(other.params), parentModule(other.parentModule)
+{
+    //if the other sound still has data at the new rate (it wasn't baked, or the file is already at the host rate) there's no need to convert it again
+    if (other.playback->sampleRate == playbackSampleRate || (playbackSampleRate <= 0 && other.playback == other.source))
+    {
+        playback = other.playback;
+    }
+    else
+    {
+        preparePlaybackData(playbackSampleRate);
+    }
+
+    if (needsBaking(settings))
+    {
+        bakePlaybackData(settings);
+    }
+
+    DBG("I'm Alive (rebuilt): " + name);
+}
+
+KrumSound::KrumSound(KrumModule* pModule, const juce::String& soundName, KrumStreamSource* streamSource,
+                     int note, int channel, double attackTimeSecs, double releaseTimeSecs)
+    : KrumSamplerSound(moduleSound), name(soundName), stream(streamSource), midiNote(note), midiChannel(channel), parentModule(pModule)
+{
+    source = stream->getHead();
+    playback = source;
+
+    params.attack = static_cast<float> (attackTimeSecs);
+    params.release = static_cast<float> (releaseTimeSecs);
+
+    DBG("I'm Alive (streamed): " + name);
+}
+
+KrumSound::KrumSound(KrumModule* pModule, const juce::String& soundName, KrumPackedSampleData* packedData,
+                     int note, int channel, double attackTimeSecs, double releaseTimeSecs)
+    : KrumSamplerSound(moduleSound), name(soundName), packed(packedData), midiNote(note), midiChannel(channel), parentModule(pModule)
+{
+    //the voices decode the packed samples themselves, the source is only here for the rate and channels
+    source = new KrumSampleData();
+    source->sampleRate = packed->sampleRate;
+    source->allocate(juce::jmax(1, packed->getNumChannels()), 0);
+    playback = source;
+
+    params.attack = static_cast<float> (attackTimeSecs);
+    params.release = static_cast<float> (releaseTimeSecs);
+
+    DBG("I'm Alive (packed): " + name);
+}
+
+juce::int64 KrumSound::getResidentBytes() const
+{
+    juce::int64 numBytes = source->getSizeInBytes();
+
+    if (packed != nullptr)
+    {
+        numBytes += packed->getSizeInBytes();
+    }
+
+    if (playback != source)
+    {
+        numBytes += playback->getSizeInBytes();
+    }
+
+    if (baked != nullptr)
+    {
+        numBytes += baked->getSizeInBytes();
+    }
+
+    return numBytes;
+}
+
+juce::String KrumSound::getStorageName() const
+{
+    if (stream != nullptr)
+    {
+        return "Streamed";
+    }
+
+    if (packed != nullptr)
+    {
+        return juce::String(packed->getBytesPerSample() * 8) + (packed->isMapped() ? " bit mapped" : " bit");
+    }
+
+    return "32 bit";
+}
+
+void KrumSound::pinSampleData(bool shouldPin)
+{
+    //the stream's head is the source, so a streamed sound only pins that, the rest of the file is read as it plays
+    juce::Array<KrumSampleData*> data { source.get(), playback.get(), baked.get() };
+
+    for (auto* d : data)
+    {
+        if (d != nullptr)
+        {
+            shouldPin ? d->pin() : d->unpin();
+        }
+    }
+
+    if (packed != nullptr)
+    {
+        shouldPin ? packed->pin() : packed->unpin();
+    }
+}
+
+bool KrumSound::isPreparedFor(double hostSampleRate, const BakeSettings& settings) const
+{
+    //streamed and packed sounds are always played as they are
+    if (stream != nullptr || packed != nullptr || hostSampleRate <= 0 || source->length == 0)
+    {
+        return true;
+    }
+
+    if (needsBaking(settings))
+    {
+        return baked != nullptr && baked->sampleRate == hostSampleRate && bakeSettings == settings;
+    }
+
+    return baked == nullptr && playback->sampleRate == hostSampleRate;
+}
+
+bool KrumSound::needsBaking(const BakeSettings& settings) const
+{
+    if (stream != nullptr || packed != nullptr)
+    {
+        return false;
+    }
+
+    return settings.reverse || settings.startSample > 0 || settings.endSample < source->length;
+}
+
+void KrumSound::bakePlaybackData(const BakeSettings& settings)
+{
+    auto& data = *playback;
+    double rateScale = data.sampleRate / source->sampleRate;
+
+    int start = juce::jlimit(0, data.length, juce::roundToInt(settings.startSample * rateScale));
+    int end = juce::jlimit(start, data.length, juce::roundToInt(settings.endSample * rateScale));
+    int numSamples = end - start + 1; //the end sample is played, same as the voice does
+
+    auto* region = new KrumSampleData();
+    region->sampleRate = data.sampleRate;
+    region->allocate(data.getNumChannels(), numSamples);
+
+    constexpr int padding = KrumSampleData::padding;
+
+    for (int channel = 0; channel < data.getNumChannels(); channel++)
+    {
+        const float* in = data.getReadPointer(channel);
+        float* out = region->getWritePointer(channel);
+
+        //the padding is filled with the audio either side of the region, so the interpolation at the edges reads what it would have read before
+        for (int i = -padding; i < numSamples + padding; i++)
+        {
+            int index = settings.reverse ? end - i : start + i;
+            out[i] = (index >= -padding && index < data.length + padding) ? in[index] : 0.0f;
+        }
+    }
+
+    region->analyse();
+    baked = region;
+    bakeSettings = settings;
+
+    //the full length copy isn't needed any more, if the module's settings move away from the bake the voices play the decoded file until the next bake lands
+    playback = source;
+}
+
+void KrumSound::preparePlaybackData(double playbackSampleRate)
+{
+    //no host rate yet, or it already matches, the voices will just play the source
+    if (playbackSampleRate <= 0 || playbackSampleRate == source->sampleRate || source->length == 0)
+    {
+        playback = source;
+        return;
+    }
+
+    auto* converted = new KrumSampleData();
+    converted->sampleRate = playbackSampleRate;
+    converted->allocate(source->getNumChannels(), KrumResampler::getConvertedLength(source->length, source->sampleRate, playbackSampleRate));
+
+    const float* in[2] = { nullptr, nullptr };
+    float* out[2] = { nullptr, nullptr };
+
+    for (int channel = 0; channel < source->getNumChannels(); channel++)
+    {
+        in[channel] = source->getReadPointer(channel);
+        out[channel] = converted->getWritePointer(channel);
+    }
+
+    KrumResampler::convertSampleRate(in, out, source->getNumChannels(), source->length, source->sampleRate, playbackSampleRate);
+    converted->analyse();
+    playback = converted;
+}
+
 KrumSound::~KrumSound()
 {
+    //sounds are released through KrumSampler::retireSound(), if you hit this the audio thread just freed the sample data
+    jassert(!KrumSampler::isRenderingAudio());
     DBG("I'm DEAD: " + name);
 }
 
+bool KrumSound::appliesToNote(int midiNoteNumber)
+{
+    return midiNote.load() == midiNoteNumber;
+}
+
+//the channel is part of the mapping, but the sampler still plays modules on any channel
+bool KrumSound::appliesToChannel(int /*midiChannel*/)
+{
+    return true;
+}
+
+const juce::String& KrumSound::getName() const
+{
+    return name;
+}
+
 std::atomic<float>* KrumSound::getModuleGain() const
 {
     return parentModule->getModuleGain();
@@ -61,14 +285,23 @@ std::atomic<float>* KrumSound::getModuleClipGain() const
     return parentModule->getModuleClipGain();
 }
 
-std::atomic<int> KrumSound::getModuleStartSample() const
+void KrumSound::getModuleSampleRange(int& startSample, int& endSample) const
 {
-    return parentModule->getModuleStartSample();
+    parentModule->getModuleSampleRange(startSample, endSample);
+
+    //a restore with no editor open never gets it's end set
+    if (endSample <= 0)
+    {
+        endSample = stream != nullptr ? stream->getLength() : packed != nullptr ? packed->length : source->length;
+    }
 }
 
-std::atomic<int> KrumSound::getModuleEndSample() const
+KrumSound::BakeSettings KrumSound::getModuleBakeSettings() const
 {
-    return parentModule->getModuleEndSample();
+    BakeSettings settings;
+    settings.reverse = *getModuleReverse() > 0.5f;
+    getModuleSampleRange(settings.startSample, settings.endSample);
+    return settings;
 }
 
 std::atomic<float>* KrumSound::getModuleMute() const
@@ -96,28 +329,59 @@ bool KrumSound::isParent(KrumModule* moduleToTest)
     return parentModule == moduleToTest;
 }
 
+void KrumSound::setMidiMapping(int newMidiNote, int newMidiChannel)
+{
+    midiNote = newMidiNote;
+    midiChannel = newMidiChannel;
+}
+
+int KrumSound::getMidiNote() const
+{
+    return midiNote.load();
+}
+
+void KrumSound::setSourceFile(const juce::File& file)
+{
+    sourceFile = file;
+    sourceFileModificationTime = file.getLastModificationTime();
+}
+
+bool KrumSound::isFromFile(const juce::File& file) const
+{
+    return file == sourceFile && file.getLastModificationTime() == sourceFileModificationTime;
+}
+
 //==================================================================================================//
 
-KrumVoice::KrumVoice()
+KrumVoice::KrumVoice(KrumSampler& owner, bool isOfflineOnly)
+    : sampler(owner), offlineOnly(isOfflineOnly)
 {
+    //the buffers are written once here so their pages are faulted in now, on the message thread, and not by the voice's first note
+    juce::FloatVectorOperations::clear(scratchL, KrumRender::renderChunkSize);
+    juce::FloatVectorOperations::clear(scratchR, KrumRender::renderChunkSize);
+    juce::FloatVectorOperations::clear(envelopeBuffer, KrumRender::renderChunkSize);
+    juce::FloatVectorOperations::clear(stagingL, maxStagedSamples + stagingPadding * 2);
+    juce::FloatVectorOperations::clear(stagingR, maxStagedSamples + stagingPadding * 2);
 }
 
 KrumVoice::~KrumVoice()
-{}
-
-bool KrumVoice::canPlaySound(juce::SynthesiserSound* sound)
 {
-    auto* krumSound = dynamic_cast<KrumSound*>(sound);
-    if (krumSound != nullptr)
+    //the voices can be rebuilt while they're playing, see KrumSampler::setPolyphony()
+    if (stream != nullptr)
     {
-        return true;
+        stream->stop();
     }
-    return false;
+}
+
+bool KrumVoice::canPlaySound(juce::SynthesiserSound* sound)
+{
+    //the offline voices just finish whatever they were playing once the host goes back to realtime
+    return KrumSamplerSound::isSoundType(sound, KrumSamplerSound::moduleSound) && (!offlineOnly || sampler.isNonRealtime());
 }
 
 bool KrumVoice::isVoiceActive() const
 {
-    return adsr.isActive();
+    return envelope.isActive();
 }
 
 void KrumVoice::startNote(int midiNoteNumber, float velocity, juce::SynthesiserSound* s, int pitchWheel)
@@ -126,32 +390,107 @@ void KrumVoice::startNote(int midiNoteNumber, float velocity, juce::SynthesiserS
     {
         if (*sound->getModuleMute() < 0.5f)
         {
-            pitchRatio = std::pow(2.0, ((*sound->getModulPitchShift() / 12.0)
-                                    * sound->sourceSampleRate / getSampleRate()));
+            int startSample = 0, endSample = 0;
+            sound->getModuleSampleRange(startSample, endSample);
+            bool reverse = *sound->getModuleReverse() > 0.5f;
+            float clipGain = *sound->getModuleClipGain();
+
+            auto& bake = sound->bakeSettings;
+            bool useBaked = sound->baked != nullptr && bake.reverse == reverse && bake.startSample == startSample && bake.endSample == endSample;
+
+            auto& playback = useBaked ? *sound->baked : *sound->playback;
+
+            //when the sound has been converted to the host rate, this is exactly 1.0 for unpitched notes
+            double pitchRatio = std::pow(2.0, *sound->getModulPitchShift() / 12.0) * playback.sampleRate / getSampleRate();
 
             outputChan = sound->getModuleOutputNumber() - 1; //index offset
 
-            startSample = sound->getModuleStartSample().load();
-            endSample = sound->getModuleEndSample().load();
+            if (useBaked)
+            {
+                //the baked region already has the trim and direction
+                reverse = false;
+
+                startSample = 0;
+                endSample = playback.length - 1;
+            }
+            else
+            {
+                //the trim is saved in samples of the file, so it's scaled to the playback data's rate
+                if (sound->playback != sound->source)
+                {
+                    double rateScale = playback.sampleRate / sound->source->sampleRate;
+                    startSample = juce::roundToInt(startSample * rateScale);
+                    endSample = juce::roundToInt(endSample * rateScale);
+                }
+            }
+
+            //a streamed sound's metadata covers the whole file, the playback data is only it's head. A packed sound's playback data is empty
+            const KrumSampleMetadata& info = sound->stream != nullptr ? sound->stream->getMetadata()
+                                           : sound->packed != nullptr ? static_cast<const KrumSampleMetadata&>(*sound->packed) : playback;
+
+            //the silence the note would end on isn't worth playing, the silence it starts with is left alone so the timing doesn't move
+            if (!sampler.isNonRealtime())
+            {
+                if (reverse)
+                {
+                    startSample = juce::jmax(startSample, info.firstAudibleSample - 1);
+                }
+                else
+                {
+                    endSample = juce::jmin(endSample, info.lastAudibleSample + 1);
+                }
+            }
+
+            bool stereoSource = playback.getNumChannels() > 1;
+
+            if (sound->stream != nullptr)
+            {
+                //reverse walks back from the end sample to the start sample, forward stops at the end sample (or the end of the file), same as below
+                stagedLength = reverse ? endSample - startSample : juce::jmin(sound->stream->getLength(), endSample) - startSample;
+                stream = sampler.startStream(*sound->stream, reverse ? endSample : startSample, reverse, (int)juce::jmax((juce::int64)0, stagedLength));
+            }
+            else if (sound->packed != nullptr)
+            {
+                packed = sound->packed.get();
+                packedOrigin = reverse ? endSample : startSample;
+                stagedLength = reverse ? endSample - startSample : juce::jmin(packed->length, endSample) - startSample;
+            }
 
-            if (*sound->getModuleReverse() < 0.5f)
+            if (isStaged())
             {
-                sourceSamplePosition = startSample;
+                //the samples are staged in the order they're played, so it's always rendered forwards, see renderStagedChunk()
+                stagedPosition = 0;
+                stagedIsStereo = stereoSource;
             }
             else
             {
-                sourceSamplePosition = endSample;
+                //a streamed sound without a stream can only play what's in it's head
+                if (sound->stream != nullptr && (reverse ? endSample : startSample) >= playback.length)
+                {
+                    stopNote(velocity, false);
+                    return;
+                }
+
+                renderState.inL = playback.getReadPointer(0);
+                renderState.inR = stereoSource ? playback.getReadPointer(1) : nullptr;
+
+                //reverse walks back from the end sample and stops at the start sample, forward stops at the end sample (or the end of the data)
+                renderState.position = KrumRender::toPhase(reverse ? endSample : startSample);
+                renderState.lowerBound = KrumRender::toPhase(startSample);
+                renderState.upperBound = KrumRender::toPhase(reverse ? playback.length : juce::jmin(playback.length, endSample));
             }
 
-            //only storing this, it will be applied in the render block
-            clipGain = sound->getModuleClipGain()->load();
+            renderState.increment = KrumRender::toPhase(pitchRatio);
+
+            playbackData = &info;
+            playingReverse = reverse;
 
             float moduleGain = *sound->getModuleGain();
             float modulePan = *sound->getModulePan();
 
             //module gain
-            lgain = velocity * (moduleGain);
-            rgain = velocity * (moduleGain);
+            float lgain = velocity * (moduleGain);
+            float rgain = velocity * (moduleGain);
 
             //panned right
             if (modulePan > 0.5f)
@@ -165,14 +504,26 @@ void KrumVoice::startNote(int midiNoteNumber, float velocity, juce::SynthesiserS
                 rgain = rgain * (modulePan);
             }
 
-            adsr.setSampleRate(sound->sourceSampleRate);
-            adsr.setParameters(sound->params);
+            renderState.gainL = clipGain * lgain;
+            renderState.gainR = clipGain * rgain;
 
-            adsr.noteOn();
+            //the unity kernels skip the interpolation, they're used when the sample plays unpitched at the host rate
+            auto interpolation = renderState.increment != KrumRender::toPhase(1.0) ? sampler.getInterpolation(sound->parentModule) : KrumRender::none;
+            renderState.sincTable = &KrumResampler::getPlaybackSincTable(pitchRatio);
+
+            bool kernelReverse = reverse && !isStaged();
+            kernels[0] = KrumRender::getKernel(kernelReverse, stereoSource, false, interpolation);
+            kernels[1] = KrumRender::getKernel(kernelReverse, stereoSource, true, interpolation);
+
+            envelope.setSampleRate(getSampleRate());
+            envelope.setParameters(sound->params);
+
+            envelope.noteOn();
         }
         else
         {
-            stopNote(velocity, true);
+            //muted, clear the note so the voice doesn't render anything
+            stopNote(velocity, false);
         }
     }
 }
@@ -181,143 +532,192 @@ void KrumVoice::stopNote(float velocity, bool allowTailOff)
 {
     if (allowTailOff)
     {
-        adsr.noteOff();
+        envelope.noteOff();
     }
     else
     {
+        if (stream != nullptr)
+        {
+            stream->stop();
+            stream = nullptr;
+        }
+
+        packed = nullptr;
         clearCurrentNote();
-        adsr.reset();
+        envelope.reset();
+        sampler.releaseVoice(this);
     }
 }
 
-void KrumVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int firstSample, int numSamples)
+float KrumVoice::getCurrentLevel() const
+{
+    return envelope.getLevel() * getRemainingPeak();
+}
+
+float KrumVoice::getRemainingPeak() const
+{
+    if (playbackData == nullptr)
+    {
+        return 0.0f;
+    }
+
+    int position = getPlaybackPosition();
+    float peak = playingReverse ? playbackData->getPeakToStart(position) : playbackData->getPeakToEnd(position);
+
+    return peak * juce::jmax(std::abs(renderState.gainL), std::abs(renderState.gainR));
+}
+
+int KrumVoice::getPlaybackPosition() const
+{
+    const juce::int64 stagedSample = stagedPosition >> KrumRender::phaseFractionBits;
+
+    if (stream != nullptr)
+    {
+        return (int)stream->getFilePosition(stagedSample);
+    }
+
+    if (packed != nullptr)
+    {
+        return (int)(playingReverse ? packedOrigin - stagedSample : packedOrigin + stagedSample);
+    }
+
+    return (int)(renderState.position >> KrumRender::phaseFractionBits);
+}
+
+int KrumVoice::getMaxStagedChunk() const
+{
+    //the staged samples have to cover the whole chunk from wherever it starts between two samples, plus one more for the interpolation
+    auto maxChunk = ((juce::int64)(maxStagedSamples - 3) << KrumRender::phaseFractionBits) / juce::jmax((juce::int64)1, renderState.increment);
+    return (int)juce::jlimit((juce::int64)1, (juce::int64)KrumRender::renderChunkSize, maxChunk);
+}
+
+int KrumVoice::renderStagedChunk(KrumRender::RenderKernel renderKernel, float* outL, float* outR, const float* envelopeChunk, float envelopeLevel, int numSamples)
 {
-    if (auto* playingSound = static_cast<KrumSound*> (getCurrentlyPlayingSound().get()))
+    constexpr juce::int64 fractionMask = ((juce::int64)1 << KrumRender::phaseFractionBits) - 1;
+
+    const juce::int64 first = stagedPosition >> KrumRender::phaseFractionBits;
+    const int numToStage = (int)(((stagedPosition & fractionMask) + renderState.increment * (numSamples - 1)) >> KrumRender::phaseFractionBits) + 2;
+
+    if (packed != nullptr)
+    {
+        //the padding is decoded too, it's the audio either side of the chunk, or silence past the ends of the sample
+        const juce::int64 from = first - stagingPadding;
+        const juce::int64 filePosition = playingReverse ? packedOrigin - from : packedOrigin + from;
+
+        packed->decode(0, filePosition, playingReverse, stagingL, numToStage + stagingPadding * 2);
+        if (stagedIsStereo)
+        {
+            packed->decode(1, filePosition, playingReverse, stagingR, numToStage + stagingPadding * 2);
+        }
+
+        renderState.inL = stagingL + stagingPadding;
+        renderState.inR = stagedIsStereo ? stagingR + stagingPadding : nullptr;
+    }
+    else if (!stream->stage(first, numToStage))
+    {
+        //offline there's time to wait for the disk, a bounce should never have holes in it
+        if (sampler.isNonRealtime())
+        {
+            auto giveUpTime = juce::Time::getMillisecondCounter() + offlineStreamTimeoutMs;
+
+            while (!stream->stage(first, numToStage) && juce::Time::getMillisecondCounter() < giveUpTime)
+            {
+                juce::Thread::sleep(1);
+            }
+        }
+        else
+        {
+            sampler.streamPool->addUnderrun();
+        }
+    }
+
+    if (stream != nullptr)
     {
-        auto& data = *playingSound->getAudioData();
-        const float* const inL = data.getReadPointer(0);
-        const float* const inR = data.getNumChannels() > 1 ? data.getReadPointer(1) : nullptr;
+        renderState.inL = stream->getStagedSamples(0);
+        renderState.inR = stagedIsStereo ? stream->getStagedSamples(1) : nullptr;
+    }
+
+    //the state is moved to the staging buffer for the kernel, the bounds go with it
+    renderState.position = stagedPosition - (first << KrumRender::phaseFractionBits);
+    renderState.lowerBound = -(first << KrumRender::phaseFractionBits);
+    renderState.upperBound = (stagedLength - first) << KrumRender::phaseFractionBits;
+
+    int numRendered = renderKernel(renderState, outL, outR, envelopeChunk, envelopeLevel, scratchL, scratchR, numSamples);
 
+    stagedPosition = renderState.position + (first << KrumRender::phaseFractionBits);
+    return numRendered;
+}
+
+void KrumVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int firstSample, int numSamples)
+{
+    if (getCurrentlyPlayingSound() != nullptr)
+    {
         int numChannels = outputBuffer.getNumChannels();
 
         float* outL = nullptr;
         float* outR = nullptr;
         
-        if (numChannels >= outputChan + 1) // + 1 accounts for stereo pair
+        if (numChannels > outputChan + 1) // + 1 accounts for stereo pair
         {
+            sampler.useOutputPair(outputBuffer, outputChan);
             outL = outputBuffer.getWritePointer(outputChan, firstSample);
             outR = outputBuffer.getWritePointer(outputChan + 1, firstSample);
         }
 
         if(outL == nullptr || outR == nullptr) // just use main output bus if we can't get the busses we want
         {
+            sampler.useOutputPair(outputBuffer, 0);
             outL = outputBuffer.getWritePointer(0, firstSample);
             outR = numChannels > 1 ? outputBuffer.getWritePointer(1, firstSample) : nullptr;
         }
 
-        if (*playingSound->getModuleReverse() > 0.5f)
-        {
-            while (--numSamples >= 0)
-            {
-                auto pos = (int)sourceSamplePosition;
-                auto alpha = (float)(sourceSamplePosition - pos);
-                auto invAlpha = 1.0f - alpha;
+        auto renderKernel = kernels[outR != nullptr ? 1 : 0];
 
-                // just using a very simple linear interpolation here..
-                float l = (inL[pos] * invAlpha + inL[pos + 1] * alpha);
-                float r = (inR != nullptr) ? (inR[pos] * invAlpha + inR[pos + 1] * alpha) : l;
+        while (numSamples > 0)
+        {
+            int numToRender = juce::jmin(numSamples, isStaged() ? getMaxStagedChunk() : KrumRender::renderChunkSize);
 
-                l = clipGain * l;
-                r = clipGain * r;
+            float envelopeLevel = 1.0f;
+            auto* envelopeChunk = envelope.getNextBlock(envelopeBuffer, numToRender, envelopeLevel);
 
-                auto envelopeValue = adsr.getNextSample();
+            int numRendered = isStaged() ? renderStagedChunk(renderKernel, outL, outR, envelopeChunk, envelopeLevel, numToRender)
+                                         : renderKernel(renderState, outL, outR, envelopeChunk, envelopeLevel, scratchL, scratchR, numToRender);
 
-                //lgain and rgain are set by our volume and panning sliders in KrumVoice::startNote()
-                l *= lgain * envelopeValue;
-                r *= rgain * envelopeValue;
+            outL += numRendered;
+            if (outR != nullptr)
+            {
+                outR += numRendered;
+            }
 
-                if (outR != nullptr)
-                {
-                    *outL++ += l;
-                    *outR++ += r;
-                }
-                else
-                {
-                    *outL++ += (l + r) * 0.5f;
-                }
+            numSamples -= numRendered;
 
-                sourceSamplePosition -= pitchRatio;
-                //--sourceSamplePosition;
-                if (sourceSamplePosition > playingSound->length || sourceSamplePosition < startSample)
-                {
-                    stopNote(0.0f, false);
-                    break;
-                }
+            //done when the sample runs out, the release does, or what's left of the sample is too quiet to hear
+            if (renderState.isFinished() || !envelope.isActive() || (!sampler.isNonRealtime() && getCurrentLevel() < tailThresholdGain))
+            {
+                stopNote(0.0f, false);
+                break;
             }
         }
-        else
-        {
-            while (--numSamples >= 0)
-            {
-                auto pos = (int)sourceSamplePosition;
-                auto alpha = (float)(sourceSamplePosition - pos);
-                auto invAlpha = 1.0f - alpha;
-
-                // just using a very simple linear interpolation here..
-                float l = (inL[pos] * invAlpha + inL[pos + 1] * alpha);
-                float r = (inR != nullptr) ? (inR[pos] * invAlpha + inR[pos + 1] * alpha) : l;
-
-                l = clipGain * l;
-                r = clipGain * r;
-
-                auto envelopeValue = adsr.getNextSample();
+    }
+}
 
-                //lgain and rgain are set by our volume and panning sliders in KrumVoice::startNote()
-                l *= lgain * envelopeValue;
-                r *= rgain * envelopeValue;
+//====================================================================================//
 
-                if (outR != nullptr)
-                {
-                    *outL++ += l;
-                    *outR++ += r;
-                }
-                else
-                {
-                    *outL++ += (l + r) * 0.5f;
-                }
-
-                sourceSamplePosition += pitchRatio;
-                //++sourceSamplePosition;
-                if (sourceSamplePosition > playingSound->length || sourceSamplePosition > endSample)
-                {
-                    stopNote(0.0f, false);
-                    break;
-                }
-            }
-        }
-    }
-}
-
-//====================================================================================//
-
-PreviewSound::PreviewSound(SimpleAudioPreviewer* prev,const juce::String& name,
+PreviewSound::PreviewSound(SimpleAudioPreviewer* prev,const juce::String& soundName,
                             juce::AudioFormatReader& source,
                             const juce::BigInteger& midiNotes,
                             int midiNoteForNormalPitch,
                             double attackTimeSecs,
                             double releaseTimeSecs,
                             double maxSampleLengthSeconds)
-    : SamplerSound(name, source, 0, midiNoteForNormalPitch, attackTimeSecs, releaseTimeSecs, maxSampleLengthSeconds),
-     previewer(prev), sourceSampleRate(source.sampleRate)
+    : KrumSamplerSound(previewSound), name(soundName), previewer(prev)
 {
-    if (sourceSampleRate > 0 && source.lengthInSamples > 0)
-    {
-        length = juce::jmin((int)source.lengthInSamples,
-            (int)(maxSampleLengthSeconds * sourceSampleRate));
+    data.sampleRate = source.sampleRate;
+    data.allocate(1, 0);
 
-        data.reset(new juce::AudioBuffer<float>(juce::jmin(2, (int)source.numChannels), length + 4));
-
-        source.read(data.get(), 0, length + 4, 0, true, true);
+    if (data.sampleRate > 0 && source.lengthInSamples > 0)
+    {
+        data.read(source, (int)juce::jmin(source.lengthInSamples, (juce::int64)(maxSampleLengthSeconds * source.sampleRate)));
 
         params.attack = static_cast<float> (attackTimeSecs);
         params.release = static_cast<float> (releaseTimeSecs);
@@ -327,6 +727,24 @@ PreviewSound::PreviewSound(SimpleAudioPreviewer* prev,const juce::String& name,
 
 PreviewSound::~PreviewSound()
 {
+    //see ~KrumSound()
+    jassert(!KrumSampler::isRenderingAudio());
+}
+
+//the preview sound is only ever started directly by the sampler, see KrumSampler::playPreviewFile()
+bool PreviewSound::appliesToNote(int /*midiNoteNumber*/)
+{
+    return false;
+}
+
+bool PreviewSound::appliesToChannel(int /*midiChannel*/)
+{
+    return true;
+}
+
+const juce::String& PreviewSound::getName() const
+{
+    return name;
 }
 
 std::atomic<float>* PreviewSound::getPreviewerGain() const
@@ -336,8 +754,13 @@ std::atomic<float>* PreviewSound::getPreviewerGain() const
 
 //====================================================================================//
 
-PreviewVoice::PreviewVoice()
+PreviewVoice::PreviewVoice(KrumSampler& owner)
+    : sampler(owner)
 {
+    //see KrumVoice()
+    juce::FloatVectorOperations::clear(scratchL, KrumRender::renderChunkSize);
+    juce::FloatVectorOperations::clear(scratchR, KrumRender::renderChunkSize);
+    juce::FloatVectorOperations::clear(envelopeBuffer, KrumRender::renderChunkSize);
 }
 
 PreviewVoice::~PreviewVoice()
@@ -346,33 +769,46 @@ PreviewVoice::~PreviewVoice()
 
 bool PreviewVoice::canPlaySound(juce::SynthesiserSound* sound)
 {
-    auto previewSound = dynamic_cast<PreviewSound*>(sound);
-    if (previewSound != nullptr)
-    {
-        return true;
-    }
-    
-    return false;
+    return KrumSamplerSound::isSoundType(sound, KrumSamplerSound::previewSound);
 }
 
 bool PreviewVoice::isVoiceActive() const
 {
-    return adsr.isActive();
+    return envelope.isActive();
 }
 
 void PreviewVoice::startNote(int /*midiNoteNumber*/, float /*velocity*/, juce::SynthesiserSound* s, int /*pitchWheel*/)
 {
-    if (auto* sound = dynamic_cast<const PreviewSound*> (s))
+    if (canPlaySound(s))
     {
-        sourceSamplePosition = 0.0;
+        auto* sound = static_cast<const PreviewSound*>(s);
+        auto& data = sound->data;
 
         gain.store(*sound->getPreviewerGain());
         //gain = newGain;
 
-        adsr.setSampleRate(sound->sourceSampleRate);
-        adsr.setParameters(sound->params);
+        //the preview file isn't converted to the host rate, so it's resampled while it plays
+        double pitchRatio = data.sampleRate / getSampleRate();
+
+        renderState.inL = data.getReadPointer(0);
+        renderState.inR = data.getNumChannels() > 1 ? data.getReadPointer(1) : nullptr;
+        renderState.position = 0;
+        renderState.increment = KrumRender::toPhase(pitchRatio);
+        renderState.lowerBound = 0;
+        renderState.upperBound = KrumRender::toPhase(data.length);
+        renderState.gainL = gain;
+        renderState.gainR = gain;
+        renderState.sincTable = &KrumResampler::getPlaybackSincTable(pitchRatio);
+
+        auto interpolation = renderState.increment != KrumRender::toPhase(1.0) ? sampler.getInterpolation(nullptr) : KrumRender::none;
+        bool stereoSource = renderState.inR != nullptr;
+        kernels[0] = KrumRender::getKernel(false, stereoSource, false, interpolation);
+        kernels[1] = KrumRender::getKernel(false, stereoSource, true, interpolation);
+
+        envelope.setSampleRate(getSampleRate());
+        envelope.setParameters(sound->params);
 
-        adsr.noteOn();
+        envelope.noteOn();
     }
 }
 
@@ -380,189 +816,1058 @@ void PreviewVoice::stopNote(float velocity, bool allowTailOff)
 {
     if (allowTailOff)
     {
-        adsr.noteOff();
+        envelope.noteOff();
     }
     else
     {
         clearCurrentNote();
-        adsr.reset();
+        envelope.reset();
     }
 }
 
 void PreviewVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
 {
-    if (auto* playingSound = static_cast<PreviewSound*> (getCurrentlyPlayingSound().get()))
+    if (getCurrentlyPlayingSound() != nullptr)
     {
-        auto& data = *playingSound->getAudioData();
-        const float* const inL = data.getReadPointer(0);
-        const float* const inR = data.getNumChannels() > 1 ? data.getReadPointer(1) : nullptr;
+        sampler.useOutputPair(outputBuffer, 0);
 
         float* outL = outputBuffer.getWritePointer(0, startSample);
         float* outR = outputBuffer.getNumChannels() > 1 ? outputBuffer.getWritePointer(1, startSample) : nullptr;
 
-        while (--numSamples >= 0)
+        auto renderKernel = kernels[outR != nullptr ? 1 : 0];
+
+        while (numSamples > 0)
+        {
+            int numToRender = juce::jmin(numSamples, KrumRender::renderChunkSize);
+
+            float envelopeLevel = 1.0f;
+            auto* envelopeChunk = envelope.getNextBlock(envelopeBuffer, numToRender, envelopeLevel);
+
+            //gain is set in PreviewVoice::startNote()
+            int numRendered = renderKernel(renderState, outL, outR, envelopeChunk, envelopeLevel, scratchL, scratchR, numToRender);
+
+            outL += numRendered;
+            if (outR != nullptr)
+            {
+                outR += numRendered;
+            }
+
+            numSamples -= numRendered;
+
+            //done when the sample runs out, or the release does
+            if (renderState.isFinished() || !envelope.isActive())
+            {
+                stopNote(0.0f, false);
+                break;
+            }
+        }
+    }
+}
+
+
+//====================================================================================//
+
+//Decodes a module's sample on the loader pool. Everything it needs from the module is copied in the constructor, on the message thread,
+//so the job never reads the module's tree.
+class KrumSampler::SampleLoadJob : public juce::ThreadPoolJob
+{
+public:
+    SampleLoadJob(KrumSampler& s, KrumModule* module, int restoreGeneration)
+        : juce::ThreadPoolJob("SampleLoadJob"), sampler(s),
+        file(module->getSampleFile()), name(module->getModuleName())
+    {
+        result.module = module;
+        result.loadId = module->loadId;
+        result.restoreGeneration = restoreGeneration;
+    }
+
+    //rebuilds an already loaded sound for the host rate and the module's bake settings, the file isn't read again
+    SampleLoadJob(KrumSampler& s, KrumModule* module, KrumSound* soundToRebuild, const KrumSound::BakeSettings& settings)
+        : SampleLoadJob(s, module, 0)
+    {
+        existingSound = soundToRebuild;
+        bakeSettings = settings;
+    }
+
+    bool belongsTo(const KrumSampler& s) const
+    {
+        return &sampler == &s;
+    }
+
+    JobStatus runJob() override
+    {
+        //read here rather than when the job is made, the host rate can change while the job is queued
+        double playbackSampleRate = sampler.getSampleRate();
+
+        //another module (maybe in another instance) already has the file decoded. If the copy at the host rate doesn't fit the budget it's loaded
+        //like any other file, so it can be packed or streamed instead
+        KrumSampleData::Ptr shared;
+        if (existingSound == nullptr)
         {
-            auto pos = (int)sourceSamplePosition;
-            auto alpha = (float)(sourceSamplePosition - pos);
-            auto invAlpha = 1.0f - alpha;
+            shared = sampler.samplePool->findDecoded(file);
 
-            // just using a very simple linear interpolation here..
-            float l = (inL[pos] * invAlpha + inL[pos + 1] * alpha);
-            float r = (inR != nullptr) ? (inR[pos] * invAlpha + inR[pos + 1] * alpha) : l;
+            if (shared != nullptr && !sampler.reserveSharedMemory(*shared, playbackSampleRate, result.reservedBytes))
+            {
+                shared = nullptr;
+            }
+        }
+
+        if (existingSound != nullptr)
+        {
+            result.sound = new KrumSound(*existingSound, playbackSampleRate, bakeSettings);
+        }
+        else if (shared != nullptr)
+        {
+            //nothing is read and only the copy at the host rate (if it needs one) is made
+            result.sound = new KrumSound(result.module, name, shared.get(), -1, 0, sampler.attackTime, sampler.releaseTime, playbackSampleRate);
+            result.numSamplesInFile = shared->length;
+            result.sound->setSourceFile(file);
+        }
+        else if (auto sharedPacked = sampler.samplePool->findPacked(file))
+        {
+            //nothing to reserve, a packed sound plays the shared data as it is and has no copy of it's own
+            result.sound = new KrumSound(result.module, name, sharedPacked.get(), -1, 0, sampler.attackTime, sampler.releaseTime);
+            result.numSamplesInFile = sharedPacked->length;
+            result.sound->setSourceFile(file);
+        }
+        else if (auto reader = sampler.createFormatReader(file, result.errorTitle, result.errorMessage))
+        {
+            //the midi mapping is filled in when the sound is published, the module's note could change while we're loading
+            result.numSamplesInFile = reader->lengthInSamples;
+
+            auto storage = sampler.reserveResidentMemory(*reader, playbackSampleRate, result.reservedBytes);
+
+            //if another instance is loading the same file right now, the pool waits for it and hands us it's data
+            if (storage == decodedStorage)
+            {
+                auto decoded = sampler.samplePool->getOrLoadDecoded(file, [&reader]() { return KrumSound::decodeFile(*reader, MAX_FILE_LENGTH_SECS); });
+
+                result.sound = new KrumSound(result.module, name, decoded.get(), -1, 0,
+                                            sampler.attackTime, sampler.releaseTime, playbackSampleRate);
+            }
+            else if (storage == packedStorage)
+            {
+                auto packedData = sampler.samplePool->getOrLoadPacked(file, [&reader]()
+                {
+                    auto* packed = new KrumPackedSampleData();
+                    const int numSamples = (int)juce::jmin(reader->lengthInSamples, (juce::int64)(MAX_FILE_LENGTH_SECS * reader->sampleRate));
+
+                    //a mapped 16 or 24 bit WAV is played straight out of the mapping, it takes the reader with it
+                    if (!packed->map(reader, numSamples))
+                    {
+                        packed->read(*reader, numSamples);
+                    }
+
+                    return packed;
+                });
+
+                result.sound = new KrumSound(result.module, name, packedData.get(), -1, 0, sampler.attackTime, sampler.releaseTime);
+            }
+            else
+            {
+                //the stream takes the reader with it, the I/O thread reads the rest of the file from it
+                result.sound = new KrumSound(result.module, name, new KrumStreamSource(std::move(reader), streamHeadSeconds), -1, 0,
+                                            sampler.attackTime, sampler.releaseTime);
+            }
+
+            result.sound->setSourceFile(file);
+        }
+
+        //touched and locked here, so the pages are in memory before the sound is published
+        if (result.sound != nullptr && KrumMemoryPinning::isEnabled())
+        {
+            result.sound->pinSampleData(true);
+        }
+
+        sampler.addLoadedSample(result);
+        return jobHasFinished;
+    }
+
+private:
+    KrumSampler& sampler;
+
+    juce::File file;
+    juce::String name;
+    KrumSound::Ptr existingSound;
+    KrumSound::BakeSettings bakeSettings;
+
+    LoadedSample result;
+};
+
+//the loader pool is shared between instances, this picks out the jobs that belong to one sampler
+struct KrumSampler::SampleLoadJobSelector : public juce::ThreadPool::JobSelector
+{
+    SampleLoadJobSelector(const KrumSampler& s) : sampler(s) {}
+
+    bool isJobSuitable(juce::ThreadPoolJob* job) override
+    {
+        auto* loadJob = dynamic_cast<SampleLoadJob*>(job);
+        return loadJob != nullptr && loadJob->belongsTo(sampler);
+    }
+
+    const KrumSampler& sampler;
+};
+
+KrumSampler::KrumSampler(juce::ValueTree* valTree, juce::AudioProcessorValueTreeState* apvts, juce::AudioFormatManager& fm, KrumSamplerAudioProcessor& o, SimpleAudioPreviewer& fp)
+    :formatManager(fm), owner(o), filePreviewer(fp)
+{
+    //the sinc tables are built up front, so the first pitched note doesn't build them on the audio thread
+    KrumResampler::prepareTables();
+
+    sampleMemoryBudget = (juce::int64)SAMPLE_MEMORY_BUDGET_MB * 1024 * 1024;
+
+    rebuildNoteDispatchTable();
+    startTimerHz(30);
+}
+
+KrumSampler::~KrumSampler()
+{
+    if (appTree != nullptr)
+    {
+        appTree->removeListener(this);
+    }
+
+    clearModules();
+
+    if (pinSamples)
+    {
+        KrumMemoryPinning::removePinRequest();
+        loaderPool->pool.addJob([]() { KrumMemoryPinning::unpinAll(); });
+    }
+}
+
+void KrumSampler::initModules(juce::ValueTree* valTree, juce::AudioProcessorValueTreeState* apvts)
+{
+    auto krumModulesTree = valTree->getChildWithName(TreeIDs::KRUMMODULES);
+
+    for (int i = 0; i < MAX_NUM_MODULES; i++)
+    {
+        auto moduleTree = krumModulesTree.getChild(i);
+        moduleTree.setProperty(TreeIDs::moduleSamplerIndex, i, nullptr);
+        modules.add(new KrumModule(*this, moduleTree, apvts));
+    }
+    
+    DBG("Modules Initialized: " + juce::String(modules.size()));
+
+    //the listener goes on the processor's tree itself, so it survives the tree being reassigned
+    appTree = valTree;
+    appTree->addListener(this);
+    updateGlobalSettings();
+
+    initVoices();
+}
+
+void KrumSampler::initVoices()
+{
+    {
+        const juce::ScopedLock sl(lock);
+        createModuleVoices();
+    }
+
+    for (int i = 0; i < NUM_PREVIEW_VOICES; i++)
+    {
+        auto newVoice = new PreviewVoice(*this);
+        newVoice->setCurrentPlaybackSampleRate(getSampleRate());
+
+        const juce::ScopedLock sl(lock);
+        voices.add(newVoice);
+        previewVoices.add(newVoice);
+    }
+    
+    juce::Logger::writeToLog("Voices Initialized: " + juce::String(voices.size()));
+    printVoices();
+    
+}
+
+void KrumSampler::setPolyphony(int numVoices)
+{
+    numVoices = juce::jlimit(MIN_POLYPHONY, MAX_POLYPHONY, numVoices);
+
+    if (numVoices == polyphony)
+    {
+        return;
+    }
+
+    polyphony = numVoices;
+
+    //no voices yet, initVoices() will make them
+    if (moduleVoices.isEmpty())
+    {
+        return;
+    }
+
+    const juce::ScopedLock sl(lock);
+
+    for (auto* voice : moduleVoices)
+    {
+        voices.removeObject(voice);
+    }
+
+    createModuleVoices();
+    juce::Logger::writeToLog("Polyphony: " + juce::String(polyphony));
+}
+
+int KrumSampler::getPolyphony() const
+{
+    return polyphony;
+}
+
+void KrumSampler::createModuleVoices()
+{
+    //the voices past the polyphony are only handed notes while the host renders offline, see setNonRealtime()
+    const int numVoices = polyphony + OFFLINE_VOICE_HEADROOM;
+
+    moduleVoices.clearQuick();
+    freeVoices.clear();
+    freeOfflineVoices.clear();
+    freeVoices.reserve((size_t)numVoices);
+    freeOfflineVoices.reserve((size_t)numVoices);
+    voiceRenderOrder.resize((size_t)numVoices);
+    moduleVoiceCounts.fill(0);
+    lastModuleVoices.fill(nullptr);
+
+    for (int i = 0; i < numVoices; i++)
+    {
+        auto* newVoice = new KrumVoice(*this, i >= polyphony);
+        newVoice->setCurrentPlaybackSampleRate(getSampleRate());
+        voices.add(newVoice);
+        moduleVoices.add(newVoice);
+    }
+
+    //pushed backwards so the first voices are handed out first
+    for (int i = numVoices; --i >= 0;)
+    {
+        auto* voice = moduleVoices.getUnchecked(i);
+        (voice->offlineOnly ? freeOfflineVoices : freeVoices).push_back(voice);
+    }
+}
+
+KrumVoice* KrumSampler::allocateVoice(int moduleIndex)
+{
+    int maxModuleVoices = modules.getUnchecked(moduleIndex)->getModuleMaxVoices();
+
+    if (maxModuleVoices == 0)
+    {
+        //without a cap a module plays one hit at a time, a retrigger restarts the voice that's still playing the last one.
+        //In realtime the offline voices that are still finishing a note after a bounce are left alone, see findQuietestVoice()
+        auto* lastVoice = lastModuleVoices[(size_t)moduleIndex];
+        if (lastVoice != nullptr && lastVoice->allocated && lastVoice->moduleIndex == moduleIndex && !(lastVoice->offlineOnly && !nonRealtime))
+        {
+            return restartVoice(lastVoice);
+        }
+    }
+    else if (moduleVoiceCounts[(size_t)moduleIndex] >= maxModuleVoices)
+    {
+        //a module at it's cap retriggers on it's own quietest voice. If all it has are offline voices in realtime they don't hold it to the cap
+        if (auto* voice = findQuietestVoice(moduleIndex))
+        {
+            return stealVoice(voice);
+        }
+    }
+
+    if (!freeVoices.empty())
+    {
+        return popFreeVoice(freeVoices);
+    }
+
+    if (nonRealtime && !freeOfflineVoices.empty())
+    {
+        return popFreeVoice(freeOfflineVoices);
+    }
+
+    return stealVoice(findQuietestVoice(-1));
+}
+
+KrumVoice* KrumSampler::stealVoice(KrumVoice* voice)
+{
+    if (voice == nullptr)
+    {
+        return nullptr;
+    }
+
+    ++numStolenVoices;
+    return restartVoice(voice);
+}
+
+KrumVoice* KrumSampler::restartVoice(KrumVoice* voice)
+{
+    //stopping the voice puts it on top of it's free list, so it's the one we get back
+    voice->stopNote(0.0f, false);
+
+    auto* freeVoice = popFreeVoice(voice->offlineOnly ? freeOfflineVoices : freeVoices);
+    jassert(freeVoice == voice);
+    return freeVoice;
+}
+
+KrumVoice* KrumSampler::popFreeVoice(std::vector<KrumVoice*>& freeList)
+{
+    auto* voice = freeList.back();
+    freeList.pop_back();
+    return voice;
+}
+
+KrumVoice* KrumSampler::findQuietestVoice(int moduleIndex)
+{
+    KrumVoice* quietestVoice = nullptr;
+    float quietestLevel = std::numeric_limits<float>::max();
+
+    for (auto* voice : moduleVoices)
+    {
+        //the offline voices can still be finishing a note after a bounce, they're left alone in realtime
+        if (!voice->allocated || (voice->offlineOnly && !nonRealtime) || (moduleIndex >= 0 && voice->moduleIndex != moduleIndex))
+        {
+            continue;
+        }
+
+        float level = voice->getCurrentLevel();
+        if (level < quietestLevel)
+        {
+            quietestLevel = level;
+            quietestVoice = voice;
+        }
+    }
+
+    return quietestVoice;
+}
+
+void KrumSampler::releaseVoice(KrumVoice* voice)
+{
+    if (voice->allocated)
+    {
+        voice->allocated = false;
+        --moduleVoiceCounts[(size_t)voice->moduleIndex];
+        (voice->offlineOnly ? freeOfflineVoices : freeVoices).push_back(voice);
+    }
+}
+
+void KrumSampler::noteOn(const int midiChannel, const int midiNoteNumber, const float velocity) 
+{
+    if (!juce::isPositiveAndBelow(midiNoteNumber, numMidiNotes))
+    {
+        return;
+    }
+
+    //the module editors trigger notes on their saved channel, which can be 0 if one was never learned
+    int channelIndex = juce::jlimit(1, numMidiChannels, midiChannel) - 1;
+    auto moduleMask = noteDispatchTable[channelIndex][midiNoteNumber].load(std::memory_order_relaxed);
+
+    for (int i = 0; moduleMask != 0; ++i, moduleMask >>= 1)
+    {
+        if ((moduleMask & 1) != 0)
+        {
+            if (auto* krumSound = modules.getUnchecked(i)->getPlaybackSound())
+            {
+                if (auto* voice = allocateVoice(i))
+                {
+                    voice->allocated = true;
+                    voice->moduleIndex = i;
+                    ++moduleVoiceCounts[(size_t)i];
+                    lastModuleVoices[(size_t)i] = voice;
+
+                    startVoice(voice, krumSound, midiChannel, midiNoteNumber, velocity);
+                }
+            }
+        }
+    }
+}
+
+void KrumSampler::noteOff(const int midiChannel, const int midiNoteNumber, const float veloctiy, bool allowTailOff) 
+{
+    //the sampler only plays one shots FOR NOW, so no need to turn any voices off here.
+    //The voice will take care of any "turning off" when the data is done rendering.
+
+}
+
+KrumModule* KrumSampler::getModule(int index)
+{
+    return modules[index];
+}
+
+void KrumSampler::addModule(KrumModule* newModule)
+{
+    modules.insert(newModule->getModuleSamplerIndex(), std::move(newModule));
+}
+
+void KrumSampler::removeModuleSample(KrumModule* moduleToDelete/*, bool updateTree*/)
+{
+    //any load that is still running for this module is out of date now
+    moduleToDelete->loadId++;
+    moduleToDelete->loading = false;
+    moduleToDelete->rebuilding = false;
+
+    if (moduleToDelete->getPlaybackSound() != nullptr)
+    {
+        swapModuleSound(moduleToDelete, nullptr);
+        DBG("sound removed");
+        printSounds();
+        return;
+    }
+
+    DBG("no sounds removed");
+}
+ 
+void KrumSampler::updateModuleSample(KrumModule* updatedModule)
+{
+    startLoad(updatedModule, 0);
+}
+
+void KrumSampler::startLoad(KrumModule* module, int restoreGeneration)
+{
+    //the module keeps playing it's current sound(if it has one) until the new one is swapped in, see publishLoadedSamples()
+    module->loadId++;
+    module->loading = true;
+    module->rebuilding = false;
+
+    loaderPool->pool.addJob(new SampleLoadJob(*this, module, restoreGeneration), true);
+}
+
+void KrumSampler::refreshModuleSounds()
+{
+    for (auto* module : modules)
+    {
+        //only one job per module at a time, a module that's loading gets checked again once it's sound is published
+        auto* sound = module->getPlaybackSound();
+        if (sound == nullptr || module->loading || module->rebuilding)
+        {
+            continue;
+        }
+
+        auto bakeSettings = sound->getModuleBakeSettings();
+        if (!sound->isPreparedFor(getSampleRate(), bakeSettings))
+        {
+            module->loadId++;
+            module->rebuilding = true;
+            loaderPool->pool.addJob(new SampleLoadJob(*this, module, sound, bakeSettings), true);
+        }
+    }
+}
+
+void KrumSampler::loadAllModuleSamples()
+{
+    juce::Array<KrumModule*> modulesToLoad;
+    for (auto* module : modules)
+    {
+        if (module->isModuleActiveOrHasFile())
+        {
+            modulesToLoad.add(module);
+        }
+    }
+
+    startRestoreLoads(modulesToLoad);
+}
+
+void KrumSampler::restoreModules(const juce::ValueTree& newModulesTree)
+{
+    juce::Array<KrumModule*> modulesToLoad;
+
+    for (int i = 0; i < modules.size(); i++)
+    {
+        auto* module = modules[i];
+        module->restoreFromTree(newModulesTree.getChild(i));
+
+        if (module->isModuleEmpty())
+        {
+            removeModuleSample(module);
+        }
+        else if (isModuleSoundCurrent(module))
+        {
+            updateModuleMidiMapping(module);
+        }
+        else
+        {
+            modulesToLoad.add(module);
+        }
+    }
+
+    DBG("Restore: reloading " + juce::String(modulesToLoad.size()) + " of " + juce::String(modules.size()) + " modules");
+    startRestoreLoads(modulesToLoad);
+}
+
+bool KrumSampler::isModuleSoundCurrent(KrumModule* module)
+{
+    auto* sound = module->getPlaybackSound();
+
+    //if a load is still running it was started with the old settings
+    return sound != nullptr && !module->isLoading() && sound->isFromFile(module->getSampleFile());
+}
+
+void KrumSampler::updateModuleMidiMapping(KrumModule* module)
+{
+    //if the module is loading, the mapping is picked up when the new sound is published
+    if (auto* sound = module->getPlaybackSound())
+    {
+        sound->setMidiMapping(module->getMidiTriggerNote(), module->getMidiTriggerChannel());
+        rebuildNoteDispatchTable();
+    }
+}
+
+void KrumSampler::rebuildNoteDispatchTable()
+{
+    static_assert(MAX_NUM_MODULES <= 32, "the dispatch table holds the modules in a 32 bit mask");
+
+    juce::uint32 noteMasks[numMidiNotes] = {};
+
+    for (int i = 0; i < modules.size(); i++)
+    {
+        if (auto* sound = modules[i]->getPlaybackSound())
+        {
+            int note = sound->getMidiNote();
+            if (juce::isPositiveAndBelow(note, numMidiNotes))
+            {
+                noteMasks[note] |= (juce::uint32)1 << i;
+            }
+        }
+    }
+
+    //the sounds play on any channel for now, so every channel gets the same row
+    for (int channel = 0; channel < numMidiChannels; channel++)
+    {
+        for (int note = 0; note < numMidiNotes; note++)
+        {
+            noteDispatchTable[channel][note].store(noteMasks[note], std::memory_order_relaxed);
+        }
+    }
+}
+
+void KrumSampler::startRestoreLoads(const juce::Array<KrumModule*>& modulesToLoad)
+{
+    if (modulesToLoad.isEmpty())
+    {
+        return;
+    }
+
+    //a batch still waiting from the last restore is out of date, every module in it is loading again or has been cleared
+    for (auto& pending : pendingRestoreLoads)
+    {
+        releaseReservedMemory(pending);
+    }
+
+    pendingRestoreLoads.clear();
+
+    int generation;
+    {
+        //the loads from an earlier restore can still be finishing, the new count is only reset under the lock they count themselves with
+        const juce::ScopedLock sl(loadedSamplesLock);
+        generation = ++restoreGeneration;
+        numRestoreLoads = modulesToLoad.size();
+        numRestoreLoadsFinished = 0;
+        restoreLoadsFinished.reset();
+    }
+
+    restoringModules = true;
+    restorePublished.reset();
+
+    for (auto* module : modulesToLoad)
+    {
+        startLoad(module, generation);
+    }
+}
+
+bool KrumSampler::isRestoringModules()
+{
+    return restoringModules;
+}
+
+void KrumSampler::getRestoreProgress(int& numLoaded, int& numToLoad)
+{
+    numLoaded = numRestoreLoadsFinished.load();
+    numToLoad = numRestoreLoads.load();
+}
+
+void KrumSampler::waitForRestoreLoads()
+{
+    if (!restoringModules)
+    {
+        return;
+    }
+
+    if (juce::MessageManager::existsAndIsCurrentThread())
+    {
+        //the timer can't publish the batch while we're holding up the message thread, so it's done here once the last load has come in
+        restoreLoadsFinished.wait(offlineRestoreTimeoutMs);
+        publishLoadedSamples();
+    }
+    else
+    {
+        restorePublished.wait(offlineRestoreTimeoutMs);
+    }
+
+    if (restoringModules)
+    {
+        juce::Logger::writeToLog("Offline render started before the restore finished loading, gave up waiting after " + juce::String(offlineRestoreTimeoutMs) + " ms");
+    }
+}
+
+void KrumSampler::cancelLoads()
+{
+    SampleLoadJobSelector selector(*this);
+    loaderPool->pool.removeAllJobs(true, 5000, &selector);
+
+    const juce::ScopedLock sl(loadedSamplesLock);
+    for (auto& loaded : loadedSamples)
+    {
+        releaseReservedMemory(loaded);
+    }
+
+    loadedSamples.clear();
+}
+
+bool KrumSampler::isModuleLoading(int moduleSamplerIndex)
+{
+    auto module = modules[moduleSamplerIndex];
+    return module != nullptr && module->isLoading();
+}
+
+juce::int64 KrumSampler::getModuleResidentBytes(int moduleSamplerIndex)
+{
+    auto module = modules[moduleSamplerIndex];
+    auto sound = module != nullptr ? module->getPlaybackSound() : nullptr;
+    return sound != nullptr ? sound->getResidentBytes() : 0;
+}
+
+juce::String KrumSampler::getModuleStorageName(int moduleSamplerIndex)
+{
+    auto module = modules[moduleSamplerIndex];
+    auto sound = module != nullptr ? module->getPlaybackSound() : nullptr;
+    return sound != nullptr ? sound->getStorageName() : juce::String();
+}
+
+void KrumSampler::addLoadedSample(const LoadedSample& loadedSample)
+{
+    const juce::ScopedLock sl(loadedSamplesLock);
+    loadedSamples.add(loadedSample);
+
+    //counted with the result, so when the count is full all the results are there. A load from an earlier restore doesn't count towards this one
+    if (loadedSample.restoreGeneration != 0 && loadedSample.restoreGeneration == restoreGeneration)
+    {
+        if (++numRestoreLoadsFinished == numRestoreLoads.load())
+        {
+            restoreLoadsFinished.signal();
+        }
+    }
+}
+
+void KrumSampler::publishLoadedSamples()
+{
+    juce::Array<LoadedSample> finishedLoads;
+    int generation;
+    bool restoreFinished;
+    {
+        //the count is read with the swap, so if it's full every result it counted is in finishedLoads or already pending
+        const juce::ScopedLock sl(loadedSamplesLock);
+        finishedLoads.swapWith(loadedSamples);
+        generation = restoreGeneration;
+        restoreFinished = numRestoreLoadsFinished.load() == numRestoreLoads.load();
+    }
+
+    if (restoringModules)
+    {
+        //loads from an earlier restore go through as normal, their modules have moved on so they're dropped below
+        for (int i = finishedLoads.size(); --i >= 0;)
+        {
+            if (finishedLoads.getReference(i).restoreGeneration == generation)
+            {
+                pendingRestoreLoads.add(finishedLoads[i]);
+                finishedLoads.remove(i);
+            }
+        }
+
+        if (restoreFinished)
+        {
+            finishedLoads.addArray(pendingRestoreLoads);
+            pendingRestoreLoads.clear();
+            restoringModules = false;
+            restorePublished.signal();
+        }
+    }
+
+    for (auto& loaded : finishedLoads)
+    {
+        auto* module = loaded.module;
+        releaseReservedMemory(loaded);
+
+        //the module has started a newer load, or had it's sample removed, since this one was started
+        if (!modules.contains(module) || loaded.loadId != module->loadId)
+        {
+            continue;
+        }
+
+        module->loading = false;
+        module->rebuilding = false;
+
+        if (loaded.sound != nullptr)
+        {
+            if (loaded.sound->isStreamed())
+            {
+                prepareStreaming();
+            }
+
+            loaded.sound->setMidiMapping(module->getMidiTriggerNote(), module->getMidiTriggerChannel());
+            if (loaded.numSamplesInFile > 0)
+            {
+                module->setNumSamplesInFile((int)loaded.numSamplesInFile);
+            }
+
+            swapModuleSound(module, loaded.sound);
+            printSounds();
+        }
+        else
+        {
+            swapModuleSound(module, nullptr);
+
+            if (loaded.errorTitle.isNotEmpty())
+            {
+                juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, loaded.errorTitle, loaded.errorMessage);
+            }
+        }
+    }
+}
+
+void KrumSampler::swapModuleSound(KrumModule* module, KrumSound::Ptr newSound)
+{
+    if (newSound != nullptr)
+    {
+        sounds.add(newSound.get());
+    }
+
+    if (auto* oldSound = module->playbackSound.exchange(newSound.get()))
+    {
+        retireSound(oldSound);
+        sounds.removeObject(oldSound);
+    }
+
+    rebuildNoteDispatchTable();
+    updateResidentBytes();
+}
+
+KrumSampler::SampleStorage KrumSampler::reserveResidentMemory(const juce::AudioFormatReader& reader, double playbackSampleRate, juce::int64& numBytesReserved)
+{
+    //the decoded file, and the copy at the host rate if it needs one. A bake can add another copy later, that's counted once it's published
+    const juce::int64 numChannels = juce::jmin(2, (int)reader.numChannels);
+    const int length = (int)reader.lengthInSamples;
+
+    const juce::int64 decodedBytes = numChannels * (length + KrumSampleData::padding * 2) * (juce::int64)sizeof(float)
+                                     + getPlaybackCopyBytes((int)numChannels, length, reader.sampleRate, playbackSampleRate);
+
+    //packed, the file is kept once at it's own rate and never baked
+    const int bytesPerPackedSample = KrumPackedSampleData::getBytesPerSample(reader);
+    const juce::int64 packedBytes = numChannels * length * (juce::int64)bytesPerPackedSample;
+
+    const bool alwaysResident = reader.lengthInSamples < RESIDENT_FILE_LENGTH_SECS * reader.sampleRate;
+
+    if (reserveBytes(decodedBytes, alwaysResident, numBytesReserved))
+    {
+        return decodedStorage;
+    }
+
+    if (bytesPerPackedSample > 0 && reserveBytes(packedBytes, false, numBytesReserved))
+    {
+        return packedStorage;
+    }
+
+    numBytesReserved = 0;
+    return streamedStorage;
+}
+
+bool KrumSampler::reserveSharedMemory(const KrumSampleData& shared, double playbackSampleRate, juce::int64& numBytesReserved)
+{
+    //the shared data is already in memory, the sound only adds it's own copy at the host rate
+    const juce::int64 copyBytes = getPlaybackCopyBytes(shared.getNumChannels(), shared.length, shared.sampleRate, playbackSampleRate);
+    const bool alwaysResident = shared.length < RESIDENT_FILE_LENGTH_SECS * shared.sampleRate;
+
+    return reserveBytes(copyBytes, alwaysResident, numBytesReserved);
+}
+
+bool KrumSampler::reserveBytes(juce::int64 numBytes, bool force, juce::int64& numBytesReserved)
+{
+    const juce::int64 totalBytes = reservedBytes.fetch_add(numBytes) + numBytes + residentBytes.load();
+
+    if (force || totalBytes <= sampleMemoryBudget.load())
+    {
+        numBytesReserved = numBytes;
+        return true;
+    }
+
+    reservedBytes -= numBytes;
+    return false;
+}
+
+juce::int64 KrumSampler::getPlaybackCopyBytes(int numChannels, int length, double sourceSampleRate, double playbackSampleRate)
+{
+    if (playbackSampleRate <= 0 || playbackSampleRate == sourceSampleRate || length == 0)
+    {
+        return 0;
+    }
 
-            auto envelopeValue = adsr.getNextSample();
+    const int convertedLength = KrumResampler::getConvertedLength(length, sourceSampleRate, playbackSampleRate);
+    return (juce::int64)numChannels * (convertedLength + KrumSampleData::padding * 2) * (juce::int64)sizeof(float);
+}
 
-            //gain is set in PreviewVoice::startNote()
-            l *= gain * envelopeValue;
-            r *= gain * envelopeValue;
+void KrumSampler::releaseReservedMemory(const LoadedSample& loadedSample)
+{
+    reservedBytes -= loadedSample.reservedBytes;
+}
 
-            if (outR != nullptr)
-            {
-                *outL++ += l;
-                *outR++ += r;
-            }
-            else
-            {
-                *outL++ += (l + r) * 0.5f;
-            }
+void KrumSampler::updateResidentBytes()
+{
+    juce::int64 numBytes = 0;
 
-            if (++sourceSamplePosition > playingSound->length)
-            {
-                stopNote(0.0f, false);
-                break;
-            }
+    for (auto* module : modules)
+    {
+        if (auto* sound = module->getPlaybackSound())
+        {
+            numBytes += sound->getResidentBytes();
         }
     }
+
+    residentBytes = numBytes;
 }
 
+void KrumSampler::setSampleMemoryBudget(juce::int64 numBytes)
+{
+    //the sounds that are already loaded stay as they are, the budget is checked when a file is loaded
+    sampleMemoryBudget = juce::jmax((juce::int64)0, numBytes);
+}
 
-//====================================================================================//
-KrumSampler::KrumSampler(juce::ValueTree* valTree, juce::AudioProcessorValueTreeState* apvts, juce::AudioFormatManager& fm, KrumSamplerAudioProcessor& o, SimpleAudioPreviewer& fp)
-    :formatManager(fm), owner(o), filePreviewer(fp)
+juce::int64 KrumSampler::getSampleMemoryBudget() const
 {
-    startTimerHz(30);
+    return sampleMemoryBudget;
 }
 
-KrumSampler::~KrumSampler()
+juce::int64 KrumSampler::getResidentBytes() const
 {
-    clearModules();
+    return residentBytes;
 }
 
-void KrumSampler::initModules(juce::ValueTree* valTree, juce::AudioProcessorValueTreeState* apvts)
+void KrumSampler::setPinSamples(bool shouldPin, juce::int64 limitInBytes)
 {
-    auto krumModulesTree = valTree->getChildWithName(TreeIDs::KRUMMODULES);
+    KrumMemoryPinning::setLimit(limitInBytes);
 
-    for (int i = 0; i < MAX_NUM_MODULES; i++)
+    if (shouldPin == pinSamples)
     {
-        auto moduleTree = krumModulesTree.getChild(i);
-        moduleTree.setProperty(TreeIDs::moduleSamplerIndex, i, nullptr);
-        modules.add(new KrumModule(*this, moduleTree, apvts));
+        return;
     }
-    
-    DBG("Modules Initialized: " + juce::String(modules.size()));
 
-    initVoices();
-}
+    pinSamples = shouldPin;
+    juce::Logger::writeToLog(juce::String("Pin Samples: ") + (shouldPin ? "On" : "Off"));
 
-void KrumSampler::initVoices()
-{
-    for (int i = 0; i < MAX_VOICES; i++)
+    if (!shouldPin)
     {
-        auto newVoice = voices.add(new KrumVoice());
-        newVoice->setCurrentPlaybackSampleRate(getSampleRate());
+        //the data is shared, another instance that still wants pinning keeps it all pinned
+        KrumMemoryPinning::removePinRequest();
+        loaderPool->pool.addJob([]() { KrumMemoryPinning::unpinAll(); });
+        return;
     }
 
-    for (int i = 0; i < NUM_PREVIEW_VOICES; i++)
+    KrumMemoryPinning::addPinRequest();
+
+    juce::ReferenceCountedArray<KrumSound> soundsToPin;
+    for (auto* module : modules)
     {
-        auto newVoice = voices.add(new PreviewVoice());
-        newVoice->setCurrentPlaybackSampleRate(getSampleRate());
+        if (auto* sound = module->getPlaybackSound())
+        {
+            soundsToPin.add(sound);
+        }
     }
-    
-    juce::Logger::writeToLog("Voices Initialized: " + juce::String(voices.size()));
-    printVoices();
-    
-}
 
-void KrumSampler::noteOn(const int midiChannel, const int midiNoteNumber, const float velocity) 
-{
-    for (auto* sound : sounds)
+    //the sounds are held by the job, if it holds the last reference they're freed there, same as retired sounds
+    loaderPool->pool.addJob([soundsToPin]() mutable
     {
-        if (sound->appliesToNote(midiNoteNumber) && sound->appliesToChannel(midiChannel))
+        for (auto* sound : soundsToPin)
         {
-            if (KrumSound* krumSound = dynamic_cast<KrumSound*>(sound))
-            {
-                auto voice = findFreeVoice(krumSound, midiChannel, midiNoteNumber, true);
-                startVoice(voice, krumSound, midiChannel, midiNoteNumber, velocity);
-            }
+            sound->pinSampleData(true);
         }
+
+        soundsToPin.clear();
+    });
+}
+
+void KrumSampler::prepareStreaming()
+{
+    if (streamPool == nullptr)
+    {
+        streamPool = std::make_unique<KrumStreamPool>(MAX_STREAMING_VOICES);
+        juce::Logger::writeToLog("Streaming Started: " + juce::String(MAX_STREAMING_VOICES) + " streams");
     }
 }
 
-void KrumSampler::noteOff(const int midiChannel, const int midiNoteNumber, const float veloctiy, bool allowTailOff) 
+KrumStream* KrumSampler::startStream(KrumStreamSource& source, int origin, bool reverse, int numSamples)
 {
-    //the sampler only plays one shots FOR NOW, so no need to turn any voices off here.
-    //The voice will take care of any "turning off" when the data is done rendering.
+    jassert(streamPool != nullptr);
+    return streamPool != nullptr ? streamPool->startStream(source, origin, reverse, numSamples) : nullptr;
+}
 
+juce::uint32 KrumSampler::getNumStreamUnderruns() const
+{
+    return streamPool != nullptr ? streamPool->getNumUnderruns() : 0;
 }
 
-KrumModule* KrumSampler::getModule(int index)
+juce::uint32 KrumSampler::getNumStreamsUnavailable() const
 {
-    return modules[index];
+    return streamPool != nullptr ? streamPool->getNumStreamsUnavailable() : 0;
 }
 
-void KrumSampler::addModule(KrumModule* newModule)
+void KrumSampler::retireSound(juce::SynthesiserSound* sound)
 {
-    modules.insert(newModule->getModuleSamplerIndex(), std::move(newModule));
+    retiredSounds.add({ sound, juce::Time::getMillisecondCounter() });
 }
 
-void KrumSampler::removeModuleSample(KrumModule* moduleToDelete/*, bool updateTree*/)
+void KrumSampler::releaseRetiredSounds()
 {
-    KrumSound* ksound = nullptr;
-    for (int i = 0; i < sounds.size(); i++)
+    auto now = juce::Time::getMillisecondCounter();
+
+    for (int i = retiredSounds.size(); --i >= 0;)
     {
-        auto sound = sounds.getObjectPointer(i);
-        ksound = static_cast<KrumSound*>(sound);
-        if (ksound && ksound->isParent(moduleToDelete))
+        auto& retired = retiredSounds.getReference(i);
+
+        //once the hold time is up and no voices are playing it, we're the only one left holding it
+        if (now - retired.retiredTime > retiredSoundHoldTimeMs && retired.sound->getReferenceCount() == 1)
         {
-            sounds.removeObject(sound);
-            DBG("sound removed");
-            printSounds();
-            return;
+            //the job holds the last reference, the sample data is freed on the pool thread when it runs. If no other sound shares the data
+            //the sample pool lets go of it there too
+            auto sound = retired.sound;
+            auto pool = samplePool;
+            retiredSounds.remove(i);
+            loaderPool->pool.addJob([sound, pool]() mutable
+            {
+                sound = nullptr;
+                pool->releaseUnused();
+            });
         }
     }
-
-    DBG("no sounds removed");
-}
- 
-void KrumSampler::updateModuleSample(KrumModule* updatedModule)
-{
-    //removes the currently assigned sound of the module, if none exist this function will do nothing
-    removeModuleSample(updatedModule);
-    addSample(updatedModule);
 }
 
-void KrumSampler::addSample(KrumModule* moduleToAddSound)
+void KrumSampler::clearModules()
 {
-    juce::File sampleFile = moduleToAddSound->getSampleFile();
-    if(auto reader = getFormatReader(sampleFile))
+    //stop any loads first, they hold pointers to the modules
+    cancelLoads();
+
+    for (auto& pending : pendingRestoreLoads)
     {
-        moduleToAddSound->setNumSamplesInFile(reader->lengthInSamples);
-        juce::BigInteger range;
-        range.setBit(moduleToAddSound->getMidiTriggerNote());
+        releaseReservedMemory(pending);
+    }
 
-        sounds.add(new KrumSound(moduleToAddSound, moduleToAddSound->getModuleName(), *reader, range, moduleToAddSound->getMidiTriggerNote(),
-                            attackTime, releaseTime, MAX_FILE_LENGTH_SECS));
+    pendingRestoreLoads.clear();
+    restoringModules = false;
+    restoreLoadsFinished.signal();
+    restorePublished.signal();
 
-        printSounds();
+    {
+        //noteOn() walks the modules on the audio thread
+        const juce::ScopedLock sl(lock);
+        modules.clear();
+        voices.clear();
+        moduleVoices.clear();
+        previewVoices.clear();
+        freeVoices.clear();
+        freeOfflineVoices.clear();
+        rebuildNoteDispatchTable();
     }
-    
-}
 
-void KrumSampler::clearModules()
-{
-    modules.clear();
-    voices.clear();
     sounds.clear();
+    retiredSounds.clear();
+    samplePool->releaseUnused();
+    residentBytes = 0;
 
     juce::Logger::writeToLog("Modules Cleared - Sounds Size: " + juce::String(sounds.size()));
 }
@@ -601,7 +1906,8 @@ void KrumSampler::addPreviewFile(juce::File& file)
         currentPreviewFile = file;
         removePreviewSound();
 
-        sounds.add(new PreviewSound(&filePreviewer, file.getFullPathName(), *reader, {}, 0, 0.001, 0.001, MAX_FILE_LENGTH_SECS));
+        //long files are only previewed up to MAX_PREVIEW_LENGTH_SECS, the preview is always decoded into memory
+        sounds.add(new PreviewSound(&filePreviewer, file.getFullPathName(), *reader, {}, 0, 0.001, 0.001, MAX_PREVIEW_LENGTH_SECS));
         
     }
     else
@@ -634,6 +1940,7 @@ void KrumSampler::playPreviewFile()
         {
             if (previewVoice->canPlaySound(soundToPlay))
             {
+                const juce::ScopedLock sl(lock);
                 startVoice(previewVoice, soundToPlay, 0, 0, 1); // midiNote = 0, velocity = 1, pitchwheel = 0 
                 break;
             }
@@ -644,13 +1951,26 @@ void KrumSampler::playPreviewFile()
 
 void KrumSampler::removePreviewSound()
 {
-    for (auto* voice : voices)
     {
-        if (auto* previewVoice = dynamic_cast<PreviewVoice*>(voice))
+        //the preview voice is rendering on the audio thread
+        const juce::ScopedLock sl(lock);
+        for (auto* voice : voices)
+        {
+            if (auto* previewVoice = dynamic_cast<PreviewVoice*>(voice))
+            {
+                previewVoice->stopNote(0, false);
+                break;
+            }
+        }
+    }
+
+    for (int i = sounds.size(); --i >= 0;)
+    {
+        auto* sound = sounds.getObjectPointer(i);
+        if (KrumSamplerSound::isSoundType(sound, KrumSamplerSound::previewSound))
         {
-            previewVoice->stopNote(0, false);
-            sounds.removeObject(previewVoice->getCurrentlyPlayingSound());
-            break;
+            retireSound(sound);
+            sounds.remove(i);
         }
     }
 }
@@ -665,9 +1985,10 @@ bool KrumSampler::isFileAcceptable(const juce::File& file, juce::int64& numSampl
         return false;
     }
 
-    if (reader->lengthInSamples / reader->sampleRate >= MAX_FILE_LENGTH_SECS)
+    //long files are streamed, this is just how long we'll go, and what fits in the int sample positions
+    if (reader->lengthInSamples / reader->sampleRate >= MAX_FILE_LENGTH_SECS || reader->lengthInSamples > maxFileLengthInSamples)
     {
-        juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon,"File Too Long!", "The maximum file length is " + juce::String(MAX_FILE_LENGTH_SECS) + " seconds.");
+        juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon,"File Too Long!", "The maximum file length is " + juce::String(MAX_FILE_LENGTH_SECS / 60) + " minutes.");
         return false;
     }
 
@@ -677,20 +1998,58 @@ bool KrumSampler::isFileAcceptable(const juce::File& file, juce::int64& numSampl
 
 std::unique_ptr<juce::AudioFormatReader> KrumSampler::getFormatReader(juce::File& file)
 {
-    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    juce::String errorTitle, errorMessage;
+    auto reader = createFormatReader(file, errorTitle, errorMessage);
     if (reader == nullptr)
     {
-        juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "File type not supported!", "The current supported file types are: " + formatManager.getWildcardForAllFormats() + ".");
+        juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, errorTitle, errorMessage);
+    }
+
+    return reader;
+}
+
+std::unique_ptr<juce::AudioFormatReader> KrumSampler::createFormatReader(const juce::File& file, juce::String& errorTitle, juce::String& errorMessage)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader = createMappedReader(file);
+    if (reader == nullptr)
+    {
+        reader.reset(formatManager.createReaderFor(file));
+    }
+
+    if (reader == nullptr)
+    {
+        errorTitle = "File type not supported!";
+        errorMessage = "The current supported file types are: " + formatManager.getWildcardForAllFormats() + ".";
         return nullptr;
     }
 
-    if (reader->lengthInSamples / reader->sampleRate >= MAX_FILE_LENGTH_SECS)
+    if (reader->lengthInSamples / reader->sampleRate >= MAX_FILE_LENGTH_SECS || reader->lengthInSamples > maxFileLengthInSamples)
     {
-        juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "File Too Long!", "The maximum file length is " + juce::String(MAX_FILE_LENGTH_SECS) + " seconds.");
+        errorTitle = "File Too Long!";
+        errorMessage = "The maximum file length is " + juce::String(MAX_FILE_LENGTH_SECS / 60) + " minutes.";
         return nullptr;
     }
 
-    return std::move(reader);
+    return reader;
+}
+
+std::unique_ptr<juce::AudioFormatReader> KrumSampler::createMappedReader(const juce::File& file)
+{
+    auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+
+    if (dynamic_cast<juce::WavAudioFormat*>(format) == nullptr && dynamic_cast<juce::AiffAudioFormat*>(format) == nullptr)
+    {
+        return nullptr;
+    }
+
+    //the formats only give us a mapped reader for the encodings they can read straight out of the file, compressed ones get nullptr
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader(format->createMemoryMappedReader(file));
+    if (reader == nullptr || !reader->mapEntireFile())
+    {
+        return nullptr;
+    }
+
+    return reader;
 }
 
 juce::AudioFormatManager& KrumSampler::getFormatManager()
@@ -700,6 +2059,44 @@ juce::AudioFormatManager& KrumSampler::getFormatManager()
 
 void KrumSampler::timerCallback()
 {
+    publishLoadedSamples();
+    refreshModuleSounds();
+    releaseRetiredSounds();
+
+    if (degradationLevel != lastLoggedDegradationLevel)
+    {
+        lastLoggedDegradationLevel = degradationLevel;
+        juce::Logger::writeToLog("Degradation Level: " + juce::String(lastLoggedDegradationLevel) + ", Load: " + juce::String(renderLoad.load(), 2)
+                                 + ", Culled Voices: " + juce::String(numCulledVoices.load()));
+    }
+
+    auto underruns = getNumStreamUnderruns();
+    if (underruns != lastLoggedUnderruns)
+    {
+        lastLoggedUnderruns = underruns;
+        juce::Logger::writeToLog("Stream Underruns: " + juce::String(underruns) + ", Streams Unavailable: " + juce::String(getNumStreamsUnavailable()));
+    }
+
+    //the pool is shared, so these count the loads of every instance
+    auto poolHits = samplePool->getNumHits();
+    auto poolMisses = samplePool->getNumMisses();
+    if (poolHits != lastLoggedPoolHits || poolMisses != lastLoggedPoolMisses)
+    {
+        lastLoggedPoolHits = poolHits;
+        lastLoggedPoolMisses = poolMisses;
+        juce::Logger::writeToLog("Sample Pool Hits: " + juce::String(poolHits) + ", Misses: " + juce::String(poolMisses)
+                                 + ", Files: " + juce::String(samplePool->getNumEntries()));
+    }
+
+    //also process wide
+    auto pinnedBytes = KrumMemoryPinning::getLockedBytes();
+    if (pinnedBytes != lastLoggedPinnedBytes)
+    {
+        lastLoggedPinnedBytes = pinnedBytes;
+        juce::Logger::writeToLog("Pinned Samples: " + juce::File::descriptionOfSizeInBytes(pinnedBytes) + " locked, "
+                                 + juce::File::descriptionOfSizeInBytes(KrumMemoryPinning::getUnlockedBytes()) + " couldn't be");
+    }
+
     if (filePreviewer.wantsToPlayFile())
     {
         playPreviewFile();
@@ -707,6 +2104,239 @@ void KrumSampler::timerCallback()
     }
 }
 
+//set on the audio thread while the sampler is rendering or handling midi
+static thread_local bool renderingAudio = false;
+
+KrumRender::Interpolation KrumSampler::getInterpolation(KrumModule* module) const
+{
+    int interpolation = module != nullptr ? module->getModuleInterpolation() : KrumRender::none;
+
+    if (interpolation <= KrumRender::none || interpolation >= KrumRender::numInterpolations)
+    {
+        interpolation = KrumRender::none;
+    }
+
+    //the interpolations are in order of quality, a bounce never sounds worse than the module was set to
+    if (nonRealtime)
+    {
+        return static_cast<KrumRender::Interpolation>(juce::jmax(interpolation, offlineInterpolation.load()));
+    }
+
+    if (interpolation == KrumRender::none)
+    {
+        interpolation = realtimeInterpolation;
+    }
+
+    //when we can't keep up, see reportRenderLoad()
+    switch (degradationLevel.load())
+    {
+    case linearInterpolation:
+        return KrumRender::linear;
+    case hermiteInterpolation:
+        return static_cast<KrumRender::Interpolation>(juce::jmin(interpolation, (int)KrumRender::hermite));
+    default:
+        return static_cast<KrumRender::Interpolation>(interpolation);
+    }
+}
+
+void KrumSampler::reportRenderLoad(double renderSeconds, double blockSeconds)
+{
+    if (blockSeconds <= 0)
+    {
+        return;
+    }
+
+    //smoothed over roughly 10 blocks, one slow block on it's own shouldn't change anything
+    float load = renderLoad;
+    load += ((float)(renderSeconds / blockSeconds) - load) * 0.1f;
+    renderLoad = load;
+
+    if (nonRealtime)
+    {
+        degradationLevel = fullQuality;
+        secondsAboveHighLoad = 0;
+        secondsBelowLowLoad = 0;
+        return;
+    }
+
+    //each only counts while the load stays in it's band, a block outside starts it again
+    secondsAboveHighLoad = load > highLoad ? secondsAboveHighLoad + blockSeconds : 0;
+    secondsBelowLowLoad = load < lowLoad ? secondsBelowLowLoad + blockSeconds : 0;
+
+    int level = degradationLevel;
+
+    if (level < numDegradationLevels - 1 && secondsAboveHighLoad > secondsBeforeDegrading)
+    {
+        degradationLevel = level + 1;
+        secondsAboveHighLoad = 0;
+    }
+    else if (level > fullQuality && secondsBelowLowLoad > secondsBeforeRecovering)
+    {
+        degradationLevel = level - 1;
+        secondsBelowLowLoad = 0;
+    }
+}
+
+KrumSampler::DegradationLevel KrumSampler::getDegradationLevel() const
+{
+    return static_cast<DegradationLevel>(degradationLevel.load());
+}
+
+float KrumSampler::getRenderLoad() const
+{
+    return renderLoad;
+}
+
+juce::uint32 KrumSampler::getNumCulledVoices() const
+{
+    return numCulledVoices;
+}
+
+juce::uint32 KrumSampler::getNumStolenVoices() const
+{
+    return numStolenVoices;
+}
+
+void KrumSampler::cullQuietVoices()
+{
+    if (degradationLevel < cullQuiet || nonRealtime)
+    {
+        return;
+    }
+
+    for (auto* voice : moduleVoices)
+    {
+        if (voice->allocated && voice->getCurrentLevel() < cullThresholdGain)
+        {
+            voice->stopNote(0.0f, false);
+            ++numCulledVoices;
+        }
+    }
+}
+
+void KrumSampler::setNonRealtime(bool isNonRealtime)
+{
+    nonRealtime = isNonRealtime;
+}
+
+bool KrumSampler::isNonRealtime() const
+{
+    return nonRealtime;
+}
+
+void KrumSampler::valueTreePropertyChanged(juce::ValueTree& treeWhoChanged, const juce::Identifier& property)
+{
+    if (treeWhoChanged.hasType(TreeIDs::GLOBALSETTINGS) &&
+        (property == TreeIDs::interpolationMode || property == TreeIDs::offlineInterpolationMode || property == TreeIDs::polyphony
+         || property == TreeIDs::sampleMemoryBudget || property == TreeIDs::pinSamples
+         || property == TreeIDs::pinnedMemoryLimit))
+    {
+        updateGlobalSettings();
+    }
+}
+
+//anything that isn't a real interpolator (older sessions won't have these at all) gets the defaults
+void KrumSampler::updateGlobalSettings()
+{
+    auto globalTree = appTree->getChildWithName(TreeIDs::GLOBALSETTINGS);
+
+    auto readSetting = [&globalTree](const juce::Identifier& id, KrumRender::Interpolation defaultInterpolation)
+    {
+        int interpolation = globalTree.getProperty(id, (int)defaultInterpolation);
+        return interpolation > KrumRender::none && interpolation < KrumRender::numInterpolations ? interpolation : (int)defaultInterpolation;
+    };
+
+    realtimeInterpolation = readSetting(TreeIDs::interpolationMode, KrumRender::linear);
+    offlineInterpolation = readSetting(TreeIDs::offlineInterpolationMode, KrumRender::sinc);
+
+    setPolyphony(globalTree.getProperty(TreeIDs::polyphony, MAX_VOICES));
+
+    int budgetMB = globalTree.getProperty(TreeIDs::sampleMemoryBudget, SAMPLE_MEMORY_BUDGET_MB);
+    setSampleMemoryBudget((juce::int64)budgetMB * 1024 * 1024);
+
+    int pinnedLimitMB = globalTree.getProperty(TreeIDs::pinnedMemoryLimit, PINNED_MEMORY_LIMIT_MB);
+    setPinSamples(globalTree.getProperty(TreeIDs::pinSamples, false), (juce::int64)pinnedLimitMB * 1024 * 1024);
+}
+
+bool KrumSampler::isRenderingAudio()
+{
+    return renderingAudio;
+}
+
+void KrumSampler::renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples)
+{
+    const juce::ScopedValueSetter<bool> audioThread(renderingAudio, true);
+    cullQuietVoices();
+
+    //The playing module voices are sorted by the pair they write to (a counting sort, the order is kept within a pair),
+    //so each pair's channels stay in cache while it's voices are mixed in. The free voices are skipped altogether.
+    std::array<int, maxOutputPairs + 1> pairStarts {};
+
+    for (auto* voice : moduleVoices)
+    {
+        if (voice->allocated)
+        {
+            ++pairStarts[(size_t)juce::jmin(voice->outputChan / 2, maxOutputPairs - 1) + 1];
+        }
+    }
+
+    for (int pair = 1; pair <= maxOutputPairs; pair++)
+    {
+        pairStarts[(size_t)pair] += pairStarts[(size_t)pair - 1];
+    }
+
+    const int numToRender = pairStarts[maxOutputPairs];
+
+    for (auto* voice : moduleVoices)
+    {
+        if (voice->allocated)
+        {
+            voiceRenderOrder[(size_t)pairStarts[(size_t)juce::jmin(voice->outputChan / 2, maxOutputPairs - 1)]++] = voice;
+        }
+    }
+
+    for (int i = 0; i < numToRender; i++)
+    {
+        voiceRenderOrder[(size_t)i]->renderNextBlock(outputAudio, startSample, numSamples);
+    }
+
+    for (auto* voice : previewVoices)
+    {
+        voice->renderNextBlock(outputAudio, startSample, numSamples);
+    }
+}
+
+void KrumSampler::startOutputBlock()
+{
+    activeOutputPairs = 0;
+}
+
+juce::uint32 KrumSampler::getActiveOutputPairs() const
+{
+    return activeOutputPairs;
+}
+
+void KrumSampler::useOutputPair(juce::AudioBuffer<float>& outputBuffer, int firstChannel)
+{
+    auto pairBit = 1u << (juce::jmin(firstChannel / 2, maxOutputPairs - 1));
+
+    if ((activeOutputPairs & pairBit) == 0)
+    {
+        activeOutputPairs |= pairBit;
+
+        for (int channel = firstChannel; channel < juce::jmin(firstChannel + 2, outputBuffer.getNumChannels()); channel++)
+        {
+            outputBuffer.clear(channel, 0, outputBuffer.getNumSamples());
+        }
+    }
+}
+
+void KrumSampler::handleMidiEvent(const juce::MidiMessage& midiMessage)
+{
+    const juce::ScopedValueSetter<bool> audioThread(renderingAudio, true);
+    juce::Synthesiser::handleMidiEvent(midiMessage);
+}
+
 void KrumSampler::printSounds()
 {
     DBG("Sounds Size = " + juce::String(sounds.size()));
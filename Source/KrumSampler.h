@@ -11,38 +11,124 @@
 #pragma once
 #include <JuceHeader.h>
 #include "KrumModule.h"
+#include "KrumRenderKernels.h"
+#include "KrumResampler.h"
+#include "KrumEnvelope.h"
+#include "KrumSampleData.h"
+#include "KrumStreaming.h"
+#include "KrumSamplePool.h"
 
 /*
 * 
-* The Sampler is comprised of three classes: juce::SamplerSound, juce::SamplerVoice and juce::Synthesizer.
+* The Sampler is comprised of three classes: juce::SynthesiserSound, juce::SynthesiserVoice and juce::Synthesizer.
 * 
-* The KrumSound(juce::SamplerSound) is responsible for holding the audio data that is to be played back.
-* The KrumVoice(juce::SamplerVoice) is responsible for rendering the audio from the KrumSound into the audio buffer. 
+* The KrumSound(juce::SynthesiserSound) is responsible for holding the audio data that is to be played back. The file is decoded once, straight into a buffer
+* that's shared with any other sound (in any instance) that plays the same file, see KrumSamplePool.
+* Long files that don't fit in the sample memory budget are kept packed as 16 or 24 bit integers if that fits, see KrumPackedSampleData,
+* otherwise they're streamed from disk and only their head is decoded up front, see KrumStreaming.h.
+* The KrumVoice(juce::SynthesiserVoice) is responsible for rendering the audio from the KrumSound into the audio buffer. 
 * The KrumSampler(juce::Synthesizer) handles the incoming midi and triggers the rendering of the KrumVoice.
 * 
+* Module samples are decoded on the sampler's loader thread pool, when a load is done the new sound is swapped into the module's playbackSound on the message thread.
+* The audio thread only ever reads that pointer, it never touches the sounds array. Sounds that get swapped out are retired and kept alive for a bit in case a note was starting with them.
+* 
 * There is also a dedicated voice for rendering the preview file. PreviewSound and PreviewVoice use slightly different methods of rendering then the it's Krum siblings
 * see PreviewSound and PreviewVoice
 * 
 */
 
-class KrumSound : public juce::SamplerSound
+//Every sound the sampler makes carries one of these, so the voices can tell what they've been handed without a dynamic_cast on the audio thread.
+//Only KrumSamplerSounds are ever added to the sampler.
+class KrumSamplerSound : public juce::SynthesiserSound
 {
 public:
+    enum SoundType
+    {
+        moduleSound,
+        previewSound,
+    };
+
+    SoundType getSoundType() const { return soundType; }
+
+    static bool isSoundType(juce::SynthesiserSound* sound, SoundType type)
+    {
+        return sound != nullptr && static_cast<KrumSamplerSound*>(sound)->getSoundType() == type;
+    }
+
+protected:
+    explicit KrumSamplerSound(SoundType type) : soundType(type) {}
+
+private:
+    const SoundType soundType;
+};
+
+class KrumSound : public KrumSamplerSound
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<KrumSound>;
+
+    //the decoded file can be shared with other sounds, it's never changed
     KrumSound   (KrumModule* parentModule, const juce::String& name,
-                juce::AudioFormatReader& source,
-                const juce::BigInteger& midiNotes,
-                int midiNoteForNormalPitch,
+                KrumSampleData* decodedFile,
+                int midiNote,
+                int midiChannel,
                 double attackTimeSecs,
                 double releaseTimeSecs,
-                double maxSampleLengthSeconds);
+                double playbackSampleRate);
+
+    //Decodes up to maxSampleLengthSeconds of the file for the constructor above, silence if the reader has nothing for us. Slow, keep it on the loader pool
+    static KrumSampleData* decodeFile(juce::AudioFormatReader& reader, double maxSampleLengthSeconds);
+
+    //The settings that can be baked into the playback data, the trim is in samples of the file.
+    //Baking these means the voice plays a forward region, no matter what the module is set to. The clip gain isn't baked, the voice applies it as it plays.
+    struct BakeSettings
+    {
+        bool reverse = false;
+        int startSample = 0;
+        int endSample = 0;
+
+        bool operator== (const BakeSettings& other) const
+        {
+            return reverse == other.reverse && startSample == other.startSample && endSample == other.endSample;
+        }
+        bool operator!= (const BakeSettings& other) const { return !operator==(other); }
+    };
+
+    //a copy of another sound for a new host rate and bake, the decoded file is shared, and so is the other sound's playback data if it's already at the new rate
+    KrumSound(const KrumSound& other, double playbackSampleRate, const BakeSettings& bakeSettings);
+
+    //A sound that streams it's file from disk. It plays the file at it's own rate and is never baked, the voices resample it while it plays.
+    KrumSound(KrumModule* parentModule, const juce::String& name,
+              KrumStreamSource* streamSource,
+              int midiNote,
+              int midiChannel,
+              double attackTimeSecs,
+              double releaseTimeSecs);
+
+    //A sound that keeps it's file packed, see KrumPackedSampleData. Like a streamed sound it plays at the file's rate and is never baked.
+    KrumSound(KrumModule* parentModule, const juce::String& name,
+              KrumPackedSampleData* packedData,
+              int midiNote,
+              int midiChannel,
+              double attackTimeSecs,
+              double releaseTimeSecs);
+
     ~KrumSound() override;
+
+    bool appliesToNote(int midiNoteNumber) override;
+    bool appliesToChannel(int midiChannel) override;
+
+    const juce::String& getName() const;
     
     std::atomic<float>* getModuleGain()const;
     std::atomic<float>* getModulePan()const;
     std::atomic<float>* getModuleClipGain()const;
     
-    std::atomic<int> getModuleStartSample() const;
-    std::atomic<int> getModuleEndSample() const;
+    //the module's trim, in samples of the file. An end of 0 hasn't been set yet (the module's editor sets it), so it's the end of the file
+    void getModuleSampleRange(int& startSample, int& endSample) const;
+
+    //the module's trim and direction right now
+    BakeSettings getModuleBakeSettings() const;
 
     std::atomic<float>* getModuleMute() const;
     std::atomic<float>* getModuleReverse() const;
@@ -53,14 +139,66 @@ public:
 
     bool isParent(KrumModule* moduleToTest);
 
+    //retargets the sound, the decoded audio is untouched so this is cheap and safe to do while it's playing
+    void setMidiMapping(int midiNote, int midiChannel);
+    int getMidiNote() const;
+
+    //true if the voices can play this unpitched at the given host rate without resampling it, and it's baked for these settings (if they need it)
+    bool isPreparedFor(double hostSampleRate, const BakeSettings& settings) const;
+
+    //nothing to bake if the sample plays forward and untrimmed
+    bool needsBaking(const BakeSettings& settings) const;
+
+    //remembers the file this sound was decoded from, and it's modification time at that point
+    void setSourceFile(const juce::File& file);
+
+    //true if the sound was decoded from this file and the file hasn't changed on disk since
+    bool isFromFile(const juce::File& file) const;
+
+    bool isStreamed() const { return stream != nullptr; }
+    bool isPacked() const { return packed != nullptr; }
+
+    //the memory the sound's audio takes up, only the head for a streamed sound
+    juce::int64 getResidentBytes() const;
+
+    //how the audio is kept, for the module's display
+    juce::String getStorageName() const;
+
+    //Pins or unpins all of the sound's audio, see KrumMemoryPinning. Loader pool only, it touches every page
+    void pinSampleData(bool shouldPin);
+
 private:
     friend class KrumVoice;
 
     juce::String name;
-    std::unique_ptr<juce::AudioBuffer<float>> data;
-    double sourceSampleRate;
-    juce::BigInteger midiNotes;
-    int length = 0, midiRootNote = 0, midiChannel = 0;
+    juce::File sourceFile;
+    juce::Time sourceFileModificationTime;
+
+    //converts the source to the host rate (if it needs it) for the voices to play
+    void preparePlaybackData(double playbackSampleRate);
+
+    //makes the baked region from the playback data, then lets go of the playback data so a baked sound only holds the source and the region
+    void bakePlaybackData(const BakeSettings& settings);
+
+    //the decoded file, at it's own rate, shared through the sample pool
+    KrumSampleData::Ptr source;
+
+    //what the voices play, the source converted to the host rate, or the source itself when the rates already match or once the sound is baked
+    KrumSampleData::Ptr playback;
+
+    //the trimmed and reversed region, nullptr if the module's settings didn't need it
+    KrumSampleData::Ptr baked;
+    BakeSettings bakeSettings;
+
+    //nullptr unless the sound is streamed, then the source and playback data are both the stream's head
+    KrumStreamSource::Ptr stream;
+
+    //nullptr unless the sound is packed, then the source and playback data are both empty, they only carry the rate and channels
+    KrumPackedSampleData::Ptr packed;
+
+    //written on the message thread, read by the audio thread in noteOn()
+    std::atomic<int> midiNote { -1 };
+    std::atomic<int> midiChannel { 0 };
     
     juce::ADSR::Parameters params;
     KrumModule* parentModule = nullptr;
@@ -68,10 +206,13 @@ private:
     JUCE_LEAK_DETECTOR(KrumSound)
 };
 
-class KrumVoice : public juce::SamplerVoice
+class KrumSampler;
+
+class KrumVoice : public juce::SynthesiserVoice
 {
 public:
-    KrumVoice();
+    //offlineOnly voices only take notes while the host is rendering offline, see KrumSampler::createModuleVoices()
+    KrumVoice(KrumSampler& owner, bool offlineOnly = false);
     ~KrumVoice() override;
 
     bool canPlaySound(juce::SynthesiserSound* sound) override;
@@ -81,19 +222,67 @@ public:
 
     void renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override;
 
+    //roughly how loud the voice is right now, the sampler steals the quietest voice first
+    float getCurrentLevel() const;
+
 private:
+    friend class KrumSampler;
 
-    friend class juce::SamplerSound;
+    //picked in startNote(), index 0 renders to a mono output, index 1 to a stereo pair
+    KrumRender::RenderKernel kernels[2] = { nullptr, nullptr };
+    KrumRender::VoiceRenderState renderState;
 
-    double pitchRatio = 0;
-    std::atomic<float> lgain = 0, rgain = 0, clipGain = 0;
-    
-    std::atomic<int> startSample, endSample;
+    int outputChan = 0;
+    KrumEnvelope envelope;
 
-    double sourceSamplePosition = 0;
+    KrumSampler& sampler;
+    const bool offlineOnly;
 
-    int outputChan = 0;
-    juce::ADSR adsr;
+    //The peak of what's left to play times the gain, a voice is stopped once this drops under tailThresholdGain.
+    //Offline renders play everything out
+    float getRemainingPeak() const;
+    static constexpr float tailThresholdGain = 0.0000316f;   //-90dB
+
+    //where the voice is in the sample it's playing
+    int getPlaybackPosition() const;
+
+    //what the voice is playing, set in startNote()
+    const KrumSampleMetadata* playbackData = nullptr;
+    bool playingReverse = false;
+
+    //A streamed or packed sound is played a chunk at a time from a staging buffer, the stream's (see KrumStreaming.h) or the voice's own
+    //that the packed samples are decoded into. The staged positions are counted from the note's start in the direction it plays,
+    //so the render state is pointed at the staging buffer for each chunk and always plays it forwards, see renderStagedChunk()
+    KrumStream* stream = nullptr;
+    const KrumPackedSampleData* packed = nullptr;
+    juce::int64 packedOrigin = 0;       //the file sample the note starts on
+    juce::int64 stagedPosition = 0;     //a phase, see KrumRender::toPhase()
+    juce::int64 stagedLength = 0;
+    bool stagedIsStereo = false;
+
+    bool isStaged() const { return stream != nullptr || packed != nullptr; }
+
+    static constexpr juce::uint32 offlineStreamTimeoutMs = 2000;   //how long an offline render waits on the disk for a chunk
+
+    int renderStagedChunk(KrumRender::RenderKernel renderKernel, float* outL, float* outR, const float* envelopeChunk, float envelopeLevel, int numSamples);
+
+    //the most samples renderStagedChunk() can render in one go at the voice's playback rate
+    int getMaxStagedChunk() const;
+
+    //the staging buffer for packed sounds, the padding either side is there for the interpolators same as KrumSampleData
+    static constexpr int maxStagedSamples = KrumStream::maxStagedSamples;
+    static constexpr int stagingPadding = KrumSampleData::padding;
+    float stagingL[maxStagedSamples + stagingPadding * 2];
+    float stagingR[maxStagedSamples + stagingPadding * 2];
+
+    //the sampler's voice pool bookkeeping, only touched under the sampler's lock, see KrumSampler::allocateVoice()
+    bool allocated = false;
+    int moduleIndex = -1;
+
+    //scratch buffers for the render kernels, see KrumRenderKernels.h
+    float scratchL[KrumRender::renderChunkSize];
+    float scratchR[KrumRender::renderChunkSize];
+    float envelopeBuffer[KrumRender::renderChunkSize];
 
     JUCE_LEAK_DETECTOR(KrumVoice)
 };
@@ -102,7 +291,7 @@ private:
 class SimpleAudioPreviewer;
 class PreviewVoice;
 
-class PreviewSound : public juce::SamplerSound
+class PreviewSound : public KrumSamplerSound
 {
 public:
     PreviewSound(SimpleAudioPreviewer* previewer, const juce::String& name,
@@ -114,14 +303,18 @@ public:
         double maxSampleLengthSeconds);
     ~PreviewSound() override;
 
+    bool appliesToNote(int midiNoteNumber) override;
+    bool appliesToChannel(int midiChannel) override;
+
+    const juce::String& getName() const;
+
     std::atomic<float>* getPreviewerGain() const;
 
 private:
     friend class PreviewVoice;
 
-    std::unique_ptr<juce::AudioBuffer<float>> data;
-    double sourceSampleRate;
-    int length = 0;
+    juce::String name;
+    KrumSampleData data;
 
     juce::ADSR::Parameters params;
 
@@ -130,10 +323,10 @@ private:
     JUCE_LEAK_DETECTOR(PreviewSound)
 };
 
-class PreviewVoice : public juce::SamplerVoice 
+class PreviewVoice : public juce::SynthesiserVoice
 {
 public: 
-    PreviewVoice();
+    PreviewVoice(KrumSampler& owner);
     ~PreviewVoice() override;
 
     bool canPlaySound(juce::SynthesiserSound* sound) override;
@@ -145,13 +338,20 @@ public:
 
 private:
 
-    friend class SamplerSound;
-
     std::atomic<float> gain = 0;
 
     //std::atomic<bool> voiceActive = false;
-    double sourceSamplePosition = 0;
-    juce::ADSR adsr;
+    KrumEnvelope envelope;
+
+    KrumSampler& sampler;
+
+    //the preview renders with the same kernels as the modules, see KrumVoice
+    KrumRender::RenderKernel kernels[2] = { nullptr, nullptr };
+    KrumRender::VoiceRenderState renderState;
+
+    float scratchL[KrumRender::renderChunkSize];
+    float scratchR[KrumRender::renderChunkSize];
+    float envelopeBuffer[KrumRender::renderChunkSize];
 
     JUCE_LEAK_DETECTOR(PreviewVoice)
 };
@@ -160,8 +360,16 @@ private:
 
 class KrumSamplerAudioProcessor;
 
+//One loader pool shared by every instance of the plugin in the process.
+//Sessions can have dozens of instances, this way they all share the cores instead of each one bringing it's own pile of threads.
+struct KrumLoaderPool
+{
+    juce::ThreadPool pool { juce::jmax(1, juce::SystemStats::getNumCpus() - 1) };
+};
+
 class KrumSampler : public juce::Synthesiser,
-                    public juce::Timer
+                    public juce::Timer,
+                    public juce::ValueTree::Listener
 {
 public:
     KrumSampler(juce::ValueTree* valTree, juce::AudioProcessorValueTreeState* apvts, juce::AudioFormatManager& fm, 
@@ -171,6 +379,11 @@ public:
     void initModules(juce::ValueTree* valTree, juce::AudioProcessorValueTreeState* apvts);
     void initVoices();
 
+    //Sets the number of module voices, between MIN_POLYPHONY and MAX_POLYPHONY. If the number changes the voices are rebuilt,
+    //which cuts off anything playing. Message thread only, this is normally set from the global settings tree.
+    void setPolyphony(int numVoices);
+    int getPolyphony() const;
+
     void noteOn(const int midiChannel, const int midiNoteNumber, const float velocity) override;
     void noteOff(const int midiChannel, const int midiNoteNumber, const float veloctiy, bool allowTailOff) override;
 
@@ -182,8 +395,33 @@ public:
     //if there is no sound that has this module as a parent, nothing will happen
     void removeModuleSample(KrumModule* moduleToDelete);
 
-    //will remove the modules current sound(if it has one) and then add the sample set in the module
+    //starts loading the sample set in the module on the loader pool, the modules current sound(if it has one) keeps playing until the new one is ready
     void updateModuleSample(KrumModule* updatedModule);
+
+    bool isModuleLoading(int moduleSamplerIndex);
+
+    //The memory the module's sound takes up, and how it's kept (see KrumSound::getStorageName()), empty if it doesn't have one. Message thread
+    juce::int64 getModuleResidentBytes(int moduleSamplerIndex);
+    juce::String getModuleStorageName(int moduleSamplerIndex);
+
+    //the module's note or channel changed, the sound it already has is retargeted, nothing is reloaded
+    void updateModuleMidiMapping(KrumModule* module);
+
+    //Used when restoring state over a sampler that already has it's modules. The new settings are copied into the live module trees,
+    //modules that still have the same file (unchanged on disk) and midi settings keep the sound they already have, the rest are reloaded.
+    void restoreModules(const juce::ValueTree& newModulesTree);
+
+    //Used when restoring state. Starts loading every module that has a file, all at once on the loader pool.
+    //The sounds are held back and swapped in together when the last one is ready, so the kit never plays half loaded.
+    void loadAllModuleSamples();
+
+    bool isRestoringModules();
+    void getRestoreProgress(int& numLoaded, int& numToLoad);
+
+    //Offline renders only, blocks until the restore batch is published (or offlineRestoreTimeoutMs has gone by) so a bounce never starts with
+    //the old kit, or half of the new one. On the message thread the batch is published here, anywhere else it waits for the timer.
+    //Never call this from the audio thread, see KrumSamplerAudioProcessor::setNonRealtime()
+    void waitForRestoreLoads();
     
     void clearModules();
 
@@ -195,20 +433,198 @@ public:
 
     bool isFileAcceptable(const juce::File& file, juce::int64& numSamplesOfFile);
 
+    //The memory the module samples can take up in this instance. A file longer than RESIDENT_FILE_LENGTH_SECS is only decoded into memory if it fits,
+    //otherwise it's packed if that fits, or else it's streamed from disk. Shorter files are always decoded, so drums never wait on the disk.
+    //Message thread, normally set from the global settings.
+    void setSampleMemoryBudget(juce::int64 numBytes);
+    juce::int64 getSampleMemoryBudget() const;
+
+    //the memory taken up by the modules' sounds right now
+    juce::int64 getResidentBytes() const;
+
+    //Pin samples mode, see KrumMemoryPinning. Pinning stays on in the process while any instance has it on. When this instance turns it on, it's
+    //sounds are pinned in the background and every sound loaded after that is pinned as it's loaded. Message thread, normally set from the global settings.
+    void setPinSamples(bool shouldPin, juce::int64 limitInBytes);
+
+    //Streaming counters, since the plugin was loaded. An underrun is a chunk a voice played with samples missing because the disk didn't keep up,
+    //an unavailable stream is a note on a streamed sound that only had the head to play because every stream was in use.
+    juce::uint32 getNumStreamUnderruns() const;
+    juce::uint32 getNumStreamsUnavailable() const;
+
     juce::AudioFormatManager& getFormatManager();
 
+    //true on a thread that is inside the sampler's render or midi handling, sample data should never be freed there
+    static bool isRenderingAudio();
+
+    //The interpolation a voice should use when it has to resample. In realtime the module's own setting wins, if it has one, otherwise it's the global setting.
+    //Offline it's the better of the module's setting and the global offline setting. Pass nullptr for the preview. Safe on the audio thread.
+    KrumRender::Interpolation getInterpolation(KrumModule* module) const;
+
+    //The processor tells us every block. While the host renders offline the voices use the offline interpolation and the extra voices
+    //past MAX_VOICES are opened up, so nothing gets stolen in a bounce. Nothing is reloaded either way, so this can flip at any block.
+    void setNonRealtime(bool isNonRealtime);
+    bool isNonRealtime() const;
+
+    //How far the sampler has backed off to keep up with the block deadline, each level includes the ones before it
+    enum DegradationLevel
+    {
+        fullQuality,            //0
+        cullQuiet,              //1, voices below cullThresholdGain are stopped
+        hermiteInterpolation,   //2, sinc is dropped to hermite
+        linearInterpolation,    //3, everything resamples with linear
+        numDegradationLevels
+    };
+
+    //The processor reports how long each block took to render against how long the block is, on the audio thread.
+    //A smoothed load above the high mark moves up a level, it has to sit under the low mark for a while to move back down.
+    //Offline renders always get full quality.
+    void reportRenderLoad(double renderSeconds, double blockSeconds);
+
+    //The processor calls startOutputBlock() before rendering a block. The first voice to write to a stereo pair in the block clears it,
+    //getActiveOutputPairs() then has a bit set for each pair that got any audio (bit 0 is channels 1-2), every other pair still needs clearing.
+    //Audio thread only
+    void startOutputBlock();
+    juce::uint32 getActiveOutputPairs() const;
+
+    //for monitoring, safe from any thread
+    DegradationLevel getDegradationLevel() const;
+    float getRenderLoad() const;
+    juce::uint32 getNumCulledVoices() const;   //since the plugin was loaded
+    juce::uint32 getNumStolenVoices() const;   //since the plugin was loaded, a module at it's voice cap retriggering counts too
+
+    void valueTreePropertyChanged(juce::ValueTree& treeWhosePropertyHasChanged, const juce::Identifier& property) override;
+
+protected:
+
+    //these just mark the audio thread for isRenderingAudio(), and then hand off to juce::Synthesiser
+    using juce::Synthesiser::renderVoices;
+    void renderVoices(juce::AudioBuffer<float>& outputAudio, int startSample, int numSamples) override;
+    void handleMidiEvent(const juce::MidiMessage& midiMessage) override;
+
 private:
+    friend class KrumVoice;
+    friend class PreviewVoice;
     
     void timerCallback()override;
 
-    //makes a Krum Sound and adds it to the samplers sounds array, using the assigned file in the passed in module
-    void addSample(KrumModule* moduleToAddSound);
+    class SampleLoadJob;
+    struct SampleLoadJobSelector;
+
+    struct LoadedSample
+    {
+        KrumModule* module = nullptr;
+        int loadId = 0;
+        int restoreGeneration = 0;          //the restore batch the load belongs to, 0 if it's not part of one
+        KrumSound::Ptr sound;
+        juce::int64 numSamplesInFile = 0;
+        juce::int64 reservedBytes = 0;      //see reserveResidentMemory()
+        juce::String errorTitle, errorMessage;
+    };
+
+    struct RetiredSound
+    {
+        juce::SynthesiserSound::Ptr sound;
+        juce::uint32 retiredTime = 0;
+    };
+
+    void startLoad(KrumModule* module, int restoreGeneration);
+
+    //Called from the timer. Any module whose sound isn't prepared for the host rate, or isn't baked for the module's current settings,
+    //gets it's sound rebuilt in the background. The decoded files are reused, nothing is read from disk.
+    void refreshModuleSounds();
+
+
+    //loads the modules as one restore batch, see loadAllModuleSamples()
+    void startRestoreLoads(const juce::Array<KrumModule*>& modulesToLoad);
+
+    //true if the module's current sound was made from the same file the module has now
+    bool isModuleSoundCurrent(KrumModule* module);
+
+    //removes this sampler's jobs from the shared pool, waiting for any that are running
+    void cancelLoads();
+
+    //called from the loader threads when a job is done
+    void addLoadedSample(const LoadedSample& loadedSample);
+
+    //swaps the finished loads into their modules, message thread only
+    void publishLoadedSamples();
+
+    //swaps the modules current sound out for newSound (can be nullptr) and retires the old one
+    void swapModuleSound(KrumModule* module, KrumSound::Ptr newSound);
+
+    //Holds on to a sound that has been taken out of the sampler. Once it's safe, the last reference is dropped on the loader pool,
+    //this way the sample data is never freed on the audio thread, even if a voice was the last one playing it.
+    void retireSound(juce::SynthesiserSound* sound);
+
+    //rebuilds the channel/note lookup noteOn() uses, call this whenever a module's sound or mapping changes (message thread)
+    void rebuildNoteDispatchTable();
+    void releaseRetiredSounds();
 
     void removePreviewSound();
 
+    //reads the global interpolation and polyphony settings from the app tree
+    void updateGlobalSettings();
+
+    //makes the module voices and their free lists, call with the lock held
+    void createModuleVoices();
+
+    //Voice pool, all of these are called on the audio thread, with the lock held.
+    //A module without a voice cap retriggers on the voice that's playing it's last hit. Otherwise a free voice comes off a free list,
+    //if there isn't one (or the module is already at it's voice cap) the quietest voice is stolen.
+    KrumVoice* allocateVoice(int moduleIndex);
+    KrumVoice* stealVoice(KrumVoice* voice);
+    KrumVoice* restartVoice(KrumVoice* voice);      //stops the voice and takes it straight back off it's free list, stealVoice() without the count
+    KrumVoice* popFreeVoice(std::vector<KrumVoice*>& freeList);
+
+    //the quietest voice the module (or any module, if moduleIndex is -1) is playing, nullptr if there isn't one
+    KrumVoice* findQuietestVoice(int moduleIndex);
+
+    //called by the voices when they stop, puts the voice back on it's free list
+    void releaseVoice(KrumVoice* voice);
+
+    //called by the voices before they add into a pair of channels, see startOutputBlock()
+    void useOutputPair(juce::AudioBuffer<float>& outputBuffer, int firstChannel);
+
+    enum SampleStorage
+    {
+        decodedStorage,     //floats, converted to the host rate and baked as needed
+        packedStorage,      //see KrumPackedSampleData
+        streamedStorage,    //see KrumStreaming.h
+    };
+
+    //Called on the loader pool before a file is read. Picks how the file is kept, the first of decoded and packed that fits the budget, or streamed if neither does.
+    //The memory it'll take up is reserved against the budget until the load is published, see releaseReservedMemory()
+    SampleStorage reserveResidentMemory(const juce::AudioFormatReader& reader, double playbackSampleRate, juce::int64& reservedBytes);
+
+    //Same for a file the sample pool already has decoded, only the sound's own copy at the host rate is reserved.
+    //Returns false if that doesn't fit, then the file should be loaded like any other
+    bool reserveSharedMemory(const KrumSampleData& shared, double playbackSampleRate, juce::int64& reservedBytes);
+    void releaseReservedMemory(const LoadedSample& loadedSample);
+
+    //adds numBytes to the reserved bytes if they fit in the budget (or force is set), numBytesReserved is only written if they do
+    bool reserveBytes(juce::int64 numBytes, bool force, juce::int64& numBytesReserved);
+
+    //the size of a sound's copy of the file at the host rate, 0 if it plays the file as it is
+    static juce::int64 getPlaybackCopyBytes(int numChannels, int length, double sourceSampleRate, double playbackSampleRate);
+    void updateResidentBytes();
+
+    //makes the stream pool the first time a streamed sound is published, message thread
+    void prepareStreaming();
+
+    //called by the voices when a note starts on a streamed sound, nullptr if every stream is in use
+    KrumStream* startStream(KrumStreamSource& source, int origin, bool reverse, int numSamples);
+
     //does the same thing as isFileAcceptable(), except returns the reader, will be nullptr if not acceptable
     std::unique_ptr<juce::AudioFormatReader> getFormatReader(juce::File& file);
 
+    //thread safe version of the above, doesn't show any alerts, instead it fills in the reason the file isn't acceptable
+    std::unique_ptr<juce::AudioFormatReader> createFormatReader(const juce::File& file, juce::String& errorTitle, juce::String& errorMessage);
+
+    //Uncompressed WAV and AIFF files are read through a memory mapped reader, so there are no read calls and every instance reading the file shares
+    //the same pages. A packed 16 or 24 bit WAV keeps the reader and the voices play straight out of the mapping, see KrumPackedSampleData::map().
+    //nullptr for anything else, or if the file can't be mapped, then createFormatReader() falls back to the normal reader
+    std::unique_ptr<juce::AudioFormatReader> createMappedReader(const juce::File& file);
+
     void printSounds();
     void printVoices();
 
@@ -220,8 +636,89 @@ private:
 
     juce::OwnedArray<KrumModule> modules;
 
+    //the processor's tree, we listen to it for the global settings
+    juce::ValueTree* appTree = nullptr;
+
+    //see setSampleMemoryBudget(), residentBytes is worked out on the message thread when the sounds change
+    std::atomic<juce::int64> sampleMemoryBudget { 0 };
+    std::atomic<juce::int64> residentBytes { 0 };
+    std::atomic<juce::int64> reservedBytes { 0 };      //by the loads that haven't been published yet
+
+    //Made on the message thread before the first streamed sound is published, and kept until the sampler goes.
+    //The voices only get to it through a streamed sound, so it's always there by the time they do.
+    std::unique_ptr<KrumStreamPool> streamPool;
+    static constexpr double streamHeadSeconds = 1.0;
+    static constexpr juce::int64 maxFileLengthInSamples = std::numeric_limits<int>::max() - KrumSampleData::padding * 2;
+    juce::uint32 lastLoggedUnderruns = 0;               //message thread
+
+    //stops the voices that are too quiet to hear, only while the degradation level asks for it. Audio thread, with the lock held
+    void cullQuietVoices();
+
+    //see reportRenderLoad(), written on the audio thread
+    std::atomic<int> degradationLevel { fullQuality };
+    std::atomic<float> renderLoad { 0.0f };
+    std::atomic<juce::uint32> numCulledVoices { 0 };
+    double secondsAboveHighLoad = 0, secondsBelowLowLoad = 0;
+    int lastLoggedDegradationLevel = fullQuality;    //message thread
+
+    static constexpr float highLoad = 0.75f;                //of the block deadline
+    static constexpr float lowLoad = 0.4f;
+    static constexpr double secondsBeforeDegrading = 0.1;
+    static constexpr double secondsBeforeRecovering = 2.0;
+    static constexpr float cullThresholdGain = 0.001f;      //-60dB
+
+    //the module voices, in the order they were made. Free voices are kept on a stack each for the realtime and the offline only voices,
+    //the stacks have room for every voice so pushing back never allocates
+    juce::Array<KrumVoice*> moduleVoices;
+    std::vector<KrumVoice*> freeVoices;
+    std::vector<KrumVoice*> freeOfflineVoices;
+    std::array<int, 32> moduleVoiceCounts {};   //one per module, a module's bit in the dispatch table limits us to 32 anyway
+    std::array<KrumVoice*, 32> lastModuleVoices {};    //the voice each module's last hit started on, see allocateVoice()
+    int polyphony = 0;
+    std::atomic<juce::uint32> numStolenVoices { 0 };
+
+    juce::Array<PreviewVoice*> previewVoices;
+
+    //see renderVoices() and useOutputPair(), audio thread only
+    static constexpr int maxOutputPairs = 32;
+    std::vector<KrumVoice*> voiceRenderOrder;
+    juce::uint32 activeOutputPairs = 0;
+
+    //read by the voices in startNote(), see getInterpolation()
+    std::atomic<int> realtimeInterpolation { KrumRender::linear };
+    std::atomic<int> offlineInterpolation { KrumRender::sinc };
+    std::atomic<bool> nonRealtime { false };
+
+    //[channel][note], each entry is a bitmask of the modules(sampler index) that play on it
+    static constexpr int numMidiChannels = 16;
+    static constexpr int numMidiNotes = 128;
+    std::atomic<juce::uint32> noteDispatchTable[numMidiChannels][numMidiNotes];
+
     SimpleAudioPreviewer& filePreviewer;
     juce::File currentPreviewFile;
 
+    juce::CriticalSection loadedSamplesLock;
+    juce::Array<LoadedSample> loadedSamples;
+
+    //restore loads wait here until the whole kit is ready, see publishLoadedSamples()
+    juce::Array<LoadedSample> pendingRestoreLoads;
+    std::atomic<bool> restoringModules { false };
+    juce::WaitableEvent restoreLoadsFinished { true };  //signalled by the loader that finishes the batch, the timer still has to publish it
+    juce::WaitableEvent restorePublished { true };
+    int restoreGeneration = 0;                          //each restore is a new batch, only touched under loadedSamplesLock
+    std::atomic<int> numRestoreLoads { 0 };
+    std::atomic<int> numRestoreLoadsFinished { 0 };
+    static constexpr int offlineRestoreTimeoutMs = 60000;
+
+    //a note could be starting with a sound right as it's swapped out, so retired sounds are held for a while before they are let go, see retireSound()
+    juce::Array<RetiredSound> retiredSounds;
+    const juce::uint32 retiredSoundHoldTimeMs = 500;
+
+    juce::SharedResourcePointer<KrumLoaderPool> loaderPool;
+    juce::SharedResourcePointer<KrumSamplePool> samplePool;
+    juce::uint32 lastLoggedPoolHits = 0, lastLoggedPoolMisses = 0;     //message thread
+    juce::int64 lastLoggedPinnedBytes = 0;                              //message thread
+    bool pinSamples = false;                                            //this instance's setting, message thread
+
     JUCE_LEAK_DETECTOR(KrumSampler)
 };
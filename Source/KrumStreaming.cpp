@@ -0,0 +1,262 @@
+/*
+  ==============================================================================
+
+    KrumStreaming.cpp
+    Created: 17 Oct 2026 9:40:05pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumStreaming.h"
+
+KrumStreamSource::KrumStreamSource(std::unique_ptr<juce::AudioFormatReader> sourceReader, double headLengthSeconds)
+    : reader(std::move(sourceReader)), length((int)reader->lengthInSamples)
+{
+    head = new KrumSampleData();
+    head->read(*reader, juce::jmin(length, (int)(headLengthSeconds * reader->sampleRate)));
+    head->analyse();
+
+    //the metadata covers the whole file, it's read a block at a time so the file is never all in memory
+    constexpr int scanBlockSize = 65536;
+    const int numChannels = head->getNumChannels();
+    juce::AudioBuffer<float> block(numChannels, scanBlockSize);
+
+    metadata.startAnalysis(length);
+
+    for (int position = 0; position < length; position += scanBlockSize)
+    {
+        const int num = juce::jmin(scanBlockSize, length - position);
+        reader->read(&block, 0, num, position, true, true);
+        metadata.analyseBlock(block.getArrayOfReadPointers(), numChannels, num);
+    }
+
+    metadata.finishAnalysis();
+}
+
+//==================================================================================================//
+
+KrumStream::KrumStream()
+    : buffer(2, bufferSize), staging(2, maxStagedSamples + padding * 2)
+{
+}
+
+KrumStream::~KrumStream()
+{
+}
+
+void KrumStream::start(KrumStreamSource& newSource, int newOrigin, bool shouldReverse, int numSamples)
+{
+    jassert(isIdle());
+
+    source = &newSource;
+    head = newSource.getHead().get();
+    origin = newOrigin;
+    reverse = shouldReverse;
+
+    //going forward the head covers the start of the note. Reversed, the head is only reached at the end of the note (if ever), so it's all read
+    firstToRead = reverse ? -padding : juce::jmax((juce::int64)-padding, (juce::int64)head->length - origin);
+    endToRead = juce::jmax(firstToRead, (juce::int64)numSamples + padding);
+
+    readEnd.store(firstToRead, std::memory_order_relaxed);
+    playPosition.store(-padding, std::memory_order_relaxed);
+
+    state.store(starting, std::memory_order_release);
+}
+
+void KrumStream::stop()
+{
+    state.store(stopping, std::memory_order_release);
+}
+
+bool KrumStream::stage(juce::int64 first, int numSamples)
+{
+    jassert(numSamples <= maxStagedSamples);
+
+    const juce::int64 from = first - padding;
+    const int numToStage = numSamples + padding * 2;
+
+    //the I/O thread can write over anything before this now
+    playPosition.store(from, std::memory_order_release);
+
+    const juce::int64 available = readEnd.load(std::memory_order_acquire);
+    const juce::int64 fileLength = source->getLength();
+    bool complete = true;
+
+    for (int channel = 0; channel < head->getNumChannels(); channel++)
+    {
+        const float* headSamples = head->getReadPointer(channel);
+        const float* ring = buffer.getReadPointer(channel);
+        float* out = staging.getWritePointer(channel);
+
+        for (int i = 0; i < numToStage; i++)
+        {
+            const juce::int64 position = from + i;
+            const juce::int64 filePosition = getFilePosition(position);
+
+            if (filePosition < 0 || filePosition >= fileLength)
+            {
+                out[i] = 0.0f;
+            }
+            else if (filePosition < head->length)
+            {
+                out[i] = headSamples[filePosition];
+            }
+            else if (position >= firstToRead && position < available)
+            {
+                out[i] = ring[position & (bufferSize - 1)];
+            }
+            else
+            {
+                out[i] = 0.0f;
+                complete = false;
+            }
+        }
+    }
+
+    return complete;
+}
+
+const float* KrumStream::getStagedSamples(int channel) const
+{
+    return staging.getReadPointer(channel) + padding;
+}
+
+//==================================================================================================//
+
+KrumDiskStreamer::KrumDiskStreamer()
+    : juce::Thread("Krum Disk Streamer"), readBuffer(2, readSize)
+{
+    startThread();
+}
+
+KrumDiskStreamer::~KrumDiskStreamer()
+{
+    stopThread(2000);
+}
+
+void KrumDiskStreamer::addPool(KrumStreamPool* pool)
+{
+    const juce::ScopedLock sl(poolLock);
+    pools.addIfNotAlreadyThere(pool);
+}
+
+void KrumDiskStreamer::removePool(KrumStreamPool* pool)
+{
+    //waits for the pass that's running, if there is one
+    const juce::ScopedLock sl(poolLock);
+    pools.removeFirstMatchingValue(pool);
+}
+
+void KrumDiskStreamer::run()
+{
+    while (!threadShouldExit())
+    {
+        bool readAnything = false;
+
+        {
+            const juce::ScopedLock sl(poolLock);
+
+            for (auto* pool : pools)
+            {
+                for (auto* stream : pool->streams)
+                {
+                    readAnything = serviceStream(*stream) || readAnything;
+                }
+            }
+        }
+
+        if (!readAnything)
+        {
+            wait(idleWaitMs);
+        }
+    }
+}
+
+bool KrumDiskStreamer::serviceStream(KrumStream& stream)
+{
+    int state = stream.state.load(std::memory_order_acquire);
+
+    if (state == KrumStream::stopping)
+    {
+        //the last reference to the source can go here, never on the audio thread
+        stream.source = nullptr;
+        stream.head = nullptr;
+        stream.state.store(KrumStream::idle, std::memory_order_release);
+        return false;
+    }
+
+    if (state == KrumStream::starting)
+    {
+        //if the voice has already stopped it, it's let go as stopping next time round
+        if (!stream.state.compare_exchange_strong(state, KrumStream::streaming, std::memory_order_acq_rel))
+        {
+            return false;
+        }
+    }
+    else if (state != KrumStream::streaming)
+    {
+        return false;
+    }
+
+    const juce::int64 readEnd = stream.readEnd.load(std::memory_order_relaxed);
+    const juce::int64 playPosition = juce::jmax(stream.firstToRead, stream.playPosition.load(std::memory_order_acquire));
+    const juce::int64 numLeft = stream.endToRead - readEnd;
+    const int numToRead = (int)juce::jmin((juce::int64)readSize, numLeft, KrumStream::bufferSize - (readEnd - playPosition));
+
+    //waits for room for a whole read, unless it's the last one
+    if (numToRead <= 0 || (numToRead < readSize && numToRead < numLeft))
+    {
+        return false;
+    }
+
+    //reversed, the block before the read end in the file is read and then turned around. Anything outside the file is read as silence
+    const juce::int64 fileStart = stream.reverse ? stream.origin - (readEnd + numToRead - 1) : stream.origin + readEnd;
+    stream.source->reader->read(&readBuffer, 0, numToRead, fileStart, true, true);
+
+    for (int channel = 0; channel < stream.head->getNumChannels(); channel++)
+    {
+        const float* in = readBuffer.getReadPointer(channel);
+        float* ring = stream.buffer.getWritePointer(channel);
+
+        for (int i = 0; i < numToRead; i++)
+        {
+            ring[(readEnd + i) & (KrumStream::bufferSize - 1)] = in[stream.reverse ? numToRead - 1 - i : i];
+        }
+    }
+
+    stream.readEnd.store(readEnd + numToRead, std::memory_order_release);
+    return true;
+}
+
+//==================================================================================================//
+
+KrumStreamPool::KrumStreamPool(int numStreams)
+{
+    for (int i = 0; i < numStreams; i++)
+    {
+        streams.add(new KrumStream());
+    }
+
+    streamer->addPool(this);
+}
+
+KrumStreamPool::~KrumStreamPool()
+{
+    streamer->removePool(this);
+}
+
+KrumStream* KrumStreamPool::startStream(KrumStreamSource& source, int origin, bool reverse, int numSamples)
+{
+    for (auto* stream : streams)
+    {
+        if (stream->isIdle())
+        {
+            stream->start(source, origin, reverse, numSamples);
+            return stream;
+        }
+    }
+
+    ++numStreamsUnavailable;
+    return nullptr;
+}
@@ -0,0 +1,183 @@
+/*
+  ==============================================================================
+
+    KrumStreaming.h
+    Created: 17 Oct 2026 9:40:05pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "KrumSampleData.h"
+
+/*
+*
+* Disk streaming, for the samples that are too long to keep in memory. See KrumSampler::reserveResidentMemory() for which samples get streamed.
+*
+* A KrumStreamSource is the streamed file. It keeps the head of the file in memory, so a note can start playing straight away while the rest is
+* read in behind it, and the silence and peak metadata for the whole file, which is worked out when it's loaded.
+*
+* A voice that plays a streamed sound takes a KrumStream from the sampler's KrumStreamPool. A stream is a ring buffer the I/O thread keeps filled
+* from the file ahead of the voice, in the order the voice plays it, so a reversed note is read backwards. For each chunk the voice copies what it
+* needs into the stream's staging buffer and renders from there with the normal kernels, which always play the staging buffer forwards.
+* If the I/O thread has fallen behind, the samples that aren't there yet play as silence and the pool counts an underrun.
+*
+* There is one KrumDiskStreamer thread shared by every instance in the process, same as the loader pool.
+* The audio thread never locks anything in here, a stream is handed back and forth between the threads with it's state, see KrumStream::State.
+*
+*/
+
+class KrumStreamSource : public juce::ReferenceCountedObject
+{
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<KrumStreamSource>;
+
+    //Reads the head and scans the whole file for the metadata, this is slow so do it on the loader pool.
+    //Once the source is made, only the I/O thread reads from the reader.
+    KrumStreamSource(std::unique_ptr<juce::AudioFormatReader> reader, double headLengthSeconds);
+
+    int getLength() const { return length; }
+    double getSampleRate() const { return head->sampleRate; }
+    int getNumChannels() const { return head->getNumChannels(); }
+
+    //the head of the file at it's own rate, the padding after it is the audio that follows
+    const KrumSampleData::Ptr& getHead() const { return head; }
+    const KrumSampleMetadata& getMetadata() const { return metadata; }
+
+private:
+    friend class KrumDiskStreamer;
+
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    KrumSampleData::Ptr head;
+    KrumSampleMetadata metadata;
+    int length = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(KrumStreamSource)
+};
+
+//The positions a stream works in are counted in samples from the note's start, in the direction it plays. So 0 is the file's origin sample,
+//and for a reversed note, position 10 is 10 samples before it in the file.
+class KrumStream
+{
+public:
+    KrumStream();
+    ~KrumStream();
+
+    //the most samples stage() can copy in one go, not counting the padding either side
+    static constexpr int maxStagedSamples = 512;
+
+    //Audio thread. Sets up an idle stream to play numSamples of the source from origin, the I/O thread starts reading on it's next pass.
+    void start(KrumStreamSource& source, int origin, bool reverse, int numSamples);
+
+    //Audio thread. The voice is done with the stream, the I/O thread lets go of the source and the stream goes back to idle.
+    void stop();
+
+    bool isIdle() const { return state.load(std::memory_order_acquire) == idle; }
+
+    //Audio thread. Copies positions [first - padding, first + numSamples + padding) of the stream into the staging buffer, and lets the
+    //I/O thread know it can reuse anything before that. Returns false if some of it wasn't read in yet, those samples are left silent.
+    bool stage(juce::int64 first, int numSamples);
+
+    //the staged sample at first, see stage()
+    const float* getStagedSamples(int channel) const;
+
+    //where a stream position is in the file
+    juce::int64 getFilePosition(juce::int64 position) const { return reverse ? origin - position : origin + position; }
+
+private:
+    friend class KrumDiskStreamer;
+
+    enum State
+    {
+        idle,       //the audio thread can start it
+        starting,   //set up by the audio thread, the I/O thread hasn't picked it up yet
+        streaming,  //the I/O thread is filling it
+        stopping,   //the voice is done with it, the I/O thread lets go of the source and sets it back to idle
+    };
+
+    static constexpr int bufferSize = 65536;   //samples per channel, a power of 2 so a position wraps with a mask
+    static constexpr int padding = KrumSampleData::padding;
+
+    std::atomic<int> state { idle };
+
+    //Set by the audio thread while the stream is idle, the only time nothing else looks at it.
+    //The source is only ever released by the I/O thread, so the audio thread never frees it.
+    KrumStreamSource::Ptr source;
+    const KrumSampleData* head = nullptr;
+    juce::int64 origin = 0;
+    bool reverse = false;
+    juce::int64 firstToRead = 0;     //the head covers everything before this
+    juce::int64 endToRead = 0;
+
+    //everything from firstToRead up to readEnd is in the buffer, written by the I/O thread
+    std::atomic<juce::int64> readEnd { 0 };
+
+    //the voice doesn't need anything before this any more, written by the audio thread
+    std::atomic<juce::int64> playPosition { 0 };
+
+    juce::AudioBuffer<float> buffer;
+    juce::AudioBuffer<float> staging;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(KrumStream)
+};
+
+class KrumStreamPool;
+
+//The I/O thread. It goes round every stream of every pool, topping up the ones that have room, and sleeps when none of them do.
+class KrumDiskStreamer : public juce::Thread
+{
+public:
+    KrumDiskStreamer();
+    ~KrumDiskStreamer() override;
+
+    //message thread, the pool is never touched again once removePool() returns
+    void addPool(KrumStreamPool* pool);
+    void removePool(KrumStreamPool* pool);
+
+    void run() override;
+
+private:
+    //returns true if it read anything
+    bool serviceStream(KrumStream& stream);
+
+    static constexpr int readSize = 4096;       //samples read from the file at a time
+    static constexpr int idleWaitMs = 5;
+
+    juce::CriticalSection poolLock;
+    juce::Array<KrumStreamPool*> pools;
+
+    juce::AudioBuffer<float> readBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(KrumDiskStreamer)
+};
+
+//The streams one sampler's voices can use, registered with the shared I/O thread for as long as it's alive
+class KrumStreamPool
+{
+public:
+    explicit KrumStreamPool(int numStreams);
+    ~KrumStreamPool();
+
+    //Audio thread. Starts an idle stream, see KrumStream::start(), nullptr (and counted) if they are all in use.
+    KrumStream* startStream(KrumStreamSource& source, int origin, bool reverse, int numSamples);
+
+    //audio thread, a voice played silence because the stream wasn't read in time
+    void addUnderrun() { ++numUnderruns; }
+
+    //since the pool was made, safe from any thread
+    juce::uint32 getNumUnderruns() const { return numUnderruns; }
+    juce::uint32 getNumStreamsUnavailable() const { return numStreamsUnavailable; }
+
+private:
+    friend class KrumDiskStreamer;
+
+    juce::OwnedArray<KrumStream> streams;
+    std::atomic<juce::uint32> numUnderruns { 0 };
+    std::atomic<juce::uint32> numStreamsUnavailable { 0 };
+
+    juce::SharedResourcePointer<KrumDiskStreamer> streamer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(KrumStreamPool)
+};
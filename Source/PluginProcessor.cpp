@@ -35,6 +35,12 @@ juce::ValueTree createValueTree()
     globalSettingsTree.setProperty(TreeIDs::previewerAutoPlay, juce::var(0), nullptr);
     globalSettingsTree.setProperty(TreeIDs::fileBrowserHidden, juce::var(0), nullptr);
     globalSettingsTree.setProperty(TreeIDs::infoPanelToggle, juce::var(1), nullptr);
+    globalSettingsTree.setProperty(TreeIDs::interpolationMode, juce::var(KrumRender::linear), nullptr);
+    globalSettingsTree.setProperty(TreeIDs::offlineInterpolationMode, juce::var(KrumRender::sinc), nullptr);
+    globalSettingsTree.setProperty(TreeIDs::polyphony, juce::var(MAX_VOICES), nullptr);
+    globalSettingsTree.setProperty(TreeIDs::sampleMemoryBudget, juce::var(SAMPLE_MEMORY_BUDGET_MB), nullptr);
+    globalSettingsTree.setProperty(TreeIDs::pinSamples, juce::var(0), nullptr);
+    globalSettingsTree.setProperty(TreeIDs::pinnedMemoryLimit, juce::var(PINNED_MEMORY_LIMIT_MB), nullptr);
 
     appStateValueTree.addChild(globalSettingsTree, -1, nullptr);
     
@@ -57,6 +63,8 @@ juce::ValueTree createValueTree()
         newModule.setProperty(TreeIDs::moduleStartSample, juce::var(0), nullptr);
         newModule.setProperty(TreeIDs::moduleEndSample, juce::var(0), nullptr);
         newModule.setProperty(TreeIDs::moduleNumSamplesLength, juce::var(0), nullptr);
+        newModule.setProperty(TreeIDs::moduleInterpolationMode, juce::var(0), nullptr);
+        newModule.setProperty(TreeIDs::moduleMaxVoices, juce::var(0), nullptr);
         /*newModule.setProperty(TreeIDs::moduleFadeIn, juce::var(0), nullptr);
         newModule.setProperty(TreeIDs::moduleFadeOut, juce::var(0), nullptr);*/
 
@@ -224,7 +232,9 @@ KrumSamplerAudioProcessor::KrumSamplerAudioProcessor()
     juce::Logger::writeToLog("Sampler Processor Constructed");
     juce::Logger::writeToLog("MaxNumModules: " + juce::String(MAX_NUM_MODULES));
     juce::Logger::writeToLog("MaxVoices: " + juce::String(MAX_VOICES));
+    juce::Logger::writeToLog("OfflineVoiceHeadroom: " + juce::String(OFFLINE_VOICE_HEADROOM));
     juce::Logger::writeToLog("MaxFileLengthInSeconds: " + juce::String(MAX_FILE_LENGTH_SECS));
+    juce::Logger::writeToLog("ResidentFileLengthInSeconds: " + juce::String(RESIDENT_FILE_LENGTH_SECS));
     juce::Logger::writeToLog("----------------------------");
 
 
@@ -239,6 +249,13 @@ void KrumSamplerAudioProcessor::prepareToPlay (double sampleRate, int samplesPer
 {
     outputGainParameter = parameters.getRawParameterValue(TreeIDs::outputGainParam);
     sampler.setCurrentPlaybackSampleRate(sampleRate);
+
+    //a bounce can't miss any notes, so it waits here for a kit that's still loading rather than in processBlock()
+    if (isNonRealtime())
+    {
+        sampler.waitForRestoreLoads();
+    }
+
     //juce::Logger::writeToLog("Processor prepared to play, sampleRate: " + juce::String(sampleRate) + ", samplesPerBlock: " +                      juce::String(samplesPerBlock));
 }
 
@@ -246,13 +263,56 @@ void KrumSamplerAudioProcessor::releaseResources()
 {
 }
 
+void KrumSamplerAudioProcessor::setNonRealtime(bool nonRealtime) noexcept
+{
+    AudioProcessor::setNonRealtime(nonRealtime);
+
+    //some wrappers switch this from inside the audio callback, those bounces are covered by prepareToPlay() or get silence until the kit is in
+    if (nonRealtime && juce::MessageManager::existsAndIsCurrentThread())
+    {
+        sampler.waitForRestoreLoads();
+    }
+}
+
 void KrumSamplerAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     midiState.processNextMidiBuffer(midiMessages, 0, buffer.getNumSamples(), true);
     
+    //bounces get the best interpolation and the extra voices, see KrumSampler::setNonRealtime()
+    sampler.setNonRealtime(isNonRealtime());
+
+    //the kit is waited for before a bounce starts, see setNonRealtime(). If it still isn't in (the wait timed out, or the host never gave
+    //us the chance) this never blocks the callback, the bounce gets silence rather than the old kit or half of the new one
+    if (isNonRealtime() && sampler.isRestoringModules())
+    {
+        buffer.clear();
+        midiMessages.clear();
+        return;
+    }
+
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    sampler.startOutputBlock();
     sampler.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
 
-    buffer.applyGain(*outputGainParameter);
+    //the sampler backs off the quality if it's getting close to the deadline, see KrumSampler::reportRenderLoad()
+    auto renderSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    sampler.reportRenderLoad(renderSeconds, buffer.getNumSamples() / getSampleRate());
+
+    //only the pairs the voices wrote to get the output gain, the rest just need clearing (hosts can hand us anything in them)
+    auto activeOutputPairs = sampler.getActiveOutputPairs();
+    float outputGain = *outputGainParameter;
+
+    for (int channel = 0; channel < buffer.getNumChannels(); channel++)
+    {
+        if ((activeOutputPairs & (1u << juce::jmin(channel / 2, 31))) != 0)
+        {
+            buffer.applyGain(channel, 0, buffer.getNumSamples(), outputGain);
+        }
+        else
+        {
+            buffer.clear(channel, 0, buffer.getNumSamples());
+        }
+    }
     
     //this does not output midi, some hosts will freak out if you send them midi when you said you wouldn't
     midiMessages.clear();
@@ -309,8 +369,12 @@ void KrumSamplerAudioProcessor::setStateInformation (const void* data, int sizeI
             }
 
             //Remaining App/Modules Settings
-            valueTree.copyPropertiesAndChildrenFrom(juce::ValueTree::fromXml(*xmlState), nullptr);
-            updateModulesFromValueTree();
+            auto newState = juce::ValueTree::fromXml(*xmlState);
+            if (!restoreModulesInPlace(newState))
+            {
+                valueTree.copyPropertiesAndChildrenFrom(newState, nullptr);
+                updateModulesFromValueTree();
+            }
             fileBrowser.getAudioPreviewer()->refreshSettings();
 
             DBG("---SET STATE---");
@@ -353,23 +417,46 @@ void KrumSamplerAudioProcessor::updateModulesFromValueTree()
     DBG("---- Updating Modules using this Tree vvvvv ----");
     DBG(valueTree.toXmlString());
 
-    auto modulesTree = valueTree.getChildWithName(TreeIDs::KRUMMODULES);
-    
-    for (int i = 0; i < modulesTree.getNumChildren(); i++)
+    //decodes every module on the loader pool, the kit starts playing once the last sample is ready
+    sampler.loadAllModuleSamples();
+}
+
+//Diffs the new state against the live tree instead of rebuilding the sampler, only the modules that changed get their samples reloaded.
+//Returns false if the trees don't line up, then the caller needs to do a full rebuild.
+bool KrumSamplerAudioProcessor::restoreModulesInPlace(const juce::ValueTree& newState)
+{
+    auto liveModulesTree = valueTree.getChildWithName(TreeIDs::KRUMMODULES);
+    auto newModulesTree = newState.getChildWithName(TreeIDs::KRUMMODULES);
+
+    if (sampler.getNumModules() != MAX_NUM_MODULES || !newModulesTree.isValid() 
+        || newModulesTree.getNumChildren() != liveModulesTree.getNumChildren())
     {
-        auto moduleTree = modulesTree.getChild(i);
-        int state = (int)moduleTree.getProperty(TreeIDs::moduleState);
+        return false;
+    }
+
+    valueTree.copyPropertiesFrom(newState, nullptr);
 
-        if (state > 0) 
-        {            
-            auto mod = sampler.getModule(moduleTree.getProperty(TreeIDs::moduleSamplerIndex));
-            sampler.updateModuleSample(mod);
+    for (int i = 0; i < newState.getNumChildren(); i++)
+    {
+        auto newChild = newState.getChild(i);
+        if (newChild.hasType(TreeIDs::KRUMMODULES))
+        {
+            continue;
+        }
+
+        auto liveChild = valueTree.getChildWithName(newChild.getType());
+        if (liveChild.isValid())
+        {
+            liveChild.copyPropertiesAndChildrenFrom(newChild, nullptr);
         }
         else
         {
-            //DBG("ValueTree not Valid " + juce::String(i));
+            valueTree.appendChild(newChild.createCopy(), nullptr);
         }
     }
+
+    sampler.restoreModules(newModulesTree);
+    return true;
 }
 
 int KrumSamplerAudioProcessor::getNumModulesInSampler()
@@ -387,6 +474,11 @@ KrumFileBrowser& KrumSamplerAudioProcessor::getFileBrowser()
     return fileBrowser;
 }
 
+KrumSampler& KrumSamplerAudioProcessor::getSampler()
+{
+    return sampler;
+}
+
 void KrumSamplerAudioProcessor::registerFormats()
 {
     formatManager->registerBasicFormats();
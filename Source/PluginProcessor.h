@@ -31,9 +31,17 @@
 
 #define GUI_REFRESH_RATE_HZ const int 30
 #define MAX_NUM_MODULES 20
-#define MAX_VOICES 14
+#define MAX_VOICES 14                       //default polyphony, it can be set from MIN_POLYPHONY to MAX_POLYPHONY in the global settings
+#define MIN_POLYPHONY 8
+#define MAX_POLYPHONY 256
+#define OFFLINE_VOICE_HEADROOM 50           //voices on top of the polyphony that are only used while the host renders offline
 #define NUM_PREVIEW_VOICES 1
-#define MAX_FILE_LENGTH_SECS 3
+#define MAX_FILE_LENGTH_SECS 3600           //longer files than this aren't loaded at all
+#define RESIDENT_FILE_LENGTH_SECS 3         //files shorter than this are always decoded into memory, longer ones are packed or streamed if they don't fit the budget
+#define SAMPLE_MEMORY_BUDGET_MB 512         //default, per instance, see KrumSampler::setSampleMemoryBudget()
+#define MAX_STREAMING_VOICES 16             //notes that can stream from disk at once, per instance
+#define PINNED_MEMORY_LIMIT_MB 1024         //default, for the whole process, see KrumMemoryPinning
+#define MAX_PREVIEW_LENGTH_SECS 30          //the previewer plays this much of a long file
 #define NUM_AUX_OUTS 20                     //mono channels
 #define SAVE_RELOAD_STATE 1                 //quick way to enable and disable getStateInfo() and setStateInfo()
 #define KRUM_BUILD_VERSION "1.4.0-Beta"     //
@@ -51,6 +59,12 @@ namespace TreeIDs
             DECLARE_ID(previewerAutoPlay)
             DECLARE_ID(fileBrowserHidden)
             DECLARE_ID(infoPanelToggle)
+            DECLARE_ID(interpolationMode)           //KrumRender::Interpolation the voices use when they resample
+            DECLARE_ID(offlineInterpolationMode)    //same, when the host is rendering offline
+            DECLARE_ID(polyphony)                   //number of module voices
+            DECLARE_ID(sampleMemoryBudget)          //in MB, see KrumSampler::setSampleMemoryBudget()
+            DECLARE_ID(pinSamples)                  //locks the sample data into RAM, see KrumMemoryPinning
+            DECLARE_ID(pinnedMemoryLimit)           //in MB
 
         DECLARE_ID(KRUMMODULES) //Module Tree
 
@@ -67,6 +81,8 @@ namespace TreeIDs
                 DECLARE_ID(moduleStartSample)
                 DECLARE_ID(moduleEndSample)
                 DECLARE_ID(moduleNumSamplesLength)
+                DECLARE_ID(moduleInterpolationMode) //0 uses the global interpolation setting
+                DECLARE_ID(moduleMaxVoices)         //hits of the module that can ring at once, 0 retriggers on the same voice
            /*     DECLARE_ID(moduleFadeIn)
                 DECLARE_ID(moduleFadeOut) */
 
@@ -159,6 +175,7 @@ public:
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void setNonRealtime (bool nonRealtime) noexcept override;
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
@@ -198,12 +215,16 @@ public:
     juce::MidiKeyboardState& getMidiState();
 
     void updateModulesFromValueTree();
+    bool restoreModulesInPlace(const juce::ValueTree& newState);
 
     int getNumModulesInSampler();
 
     juce::AudioThumbnailCache& getThumbnailCache();
     KrumFileBrowser& getFileBrowser();
 
+    //for the engine tests and benchmarks, see Tests/
+    KrumSampler& getSampler();
+
 private:
     
     void registerFormats();
@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    EnvelopeBenchmarks.cpp
+    Created: 18 Oct 2026 1:15:40am
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumTestHelpers.h"
+
+//KrumEnvelope::getNextBlock() against juce::ADSR::getNextSample(), which the voices used before it. A note is held for a second and released,
+//in renderChunkSize chunks like the voices ask for them. A flat KrumEnvelope chunk is just it's level, the voice folds that into the gain,
+//so that's all that is read back here. The sampler's own envelope is mostly sustain, the other one is ramps the whole way through
+class EnvelopeBenchmarks : public juce::UnitTest
+{
+public:
+    EnvelopeBenchmarks() : juce::UnitTest("Envelope", "KrumSamplerBenchmarks") {}
+
+    void runTest() override
+    {
+        beginTest("Sampler envelope");
+        compare({ 0.01f, 0.1f, 1.0f, 0.01f });
+
+        beginTest("Long ramps");
+        compare({ 0.5f, 0.5f, 0.5f, 0.5f });
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int noteLength = 48000;
+
+    void compare(const juce::ADSR::Parameters& parameters)
+    {
+        float krumSum = 0.0f, adsrSum = 0.0f;
+
+        auto krumSeconds = KrumTest::timeAverage([&]()
+        {
+            KrumEnvelope envelope;
+            envelope.setSampleRate(sampleRate);
+            envelope.setParameters(parameters);
+            envelope.noteOn();
+
+            float levels[KrumRender::renderChunkSize];
+            krumSum = 0.0f;
+
+            for (int i = 0; envelope.isActive(); i += KrumRender::renderChunkSize)
+            {
+                if (i >= noteLength && i < noteLength + KrumRender::renderChunkSize)
+                {
+                    envelope.noteOff();
+                }
+
+                float level = 0.0f;
+                if (auto* block = envelope.getNextBlock(levels, KrumRender::renderChunkSize, level))
+                {
+                    for (int j = 0; j < KrumRender::renderChunkSize; j++)
+                    {
+                        krumSum += block[j];
+                    }
+                }
+                else
+                {
+                    krumSum += level * KrumRender::renderChunkSize;
+                }
+            }
+        });
+
+        auto adsrSeconds = KrumTest::timeAverage([&]()
+        {
+            juce::ADSR adsr;
+            adsr.setSampleRate(sampleRate);
+            adsr.setParameters(parameters);
+            adsr.noteOn();
+
+            float levels[KrumRender::renderChunkSize];
+            adsrSum = 0.0f;
+
+            for (int i = 0; adsr.isActive(); i += KrumRender::renderChunkSize)
+            {
+                if (i >= noteLength && i < noteLength + KrumRender::renderChunkSize)
+                {
+                    adsr.noteOff();
+                }
+
+                for (int j = 0; j < KrumRender::renderChunkSize; j++)
+                {
+                    levels[j] = adsr.getNextSample();
+                }
+
+                for (int j = 0; j < KrumRender::renderChunkSize; j++)
+                {
+                    adsrSum += levels[j];
+                }
+            }
+        });
+
+        //the same shape, so the same area under it give or take a sample or two at each segment change
+        expectWithinAbsoluteError(krumSum, adsrSum, adsrSum * 0.001f);
+
+        logMessage("KrumEnvelope " + juce::String(krumSeconds * 1.0e6, 1) + " us per note, juce::ADSR " + juce::String(adsrSeconds * 1.0e6, 1)
+                   + " us per note, " + juce::String(adsrSeconds / krumSeconds, 1) + "x");
+    }
+};
+
+static EnvelopeBenchmarks envelopeBenchmarks;
@@ -0,0 +1,132 @@
+/*
+  ==============================================================================
+
+    FixedPointPhaseTests.cpp
+    Created: 17 Oct 2026 11:59:48pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumTestHelpers.h"
+#include "../../Source/KrumRenderKernels.h"
+#include "../../Source/KrumSampleData.h"
+
+//The resampling kernels step a 32.32 fixed point phase, they used to step a double. This renders noise through the kernels
+//and through a copy of the old double loop and checks they still agree, the length to the sample and the audio to well under
+//anything you could hear. Noise so every interpolated sample counts, a sine would hide errors near it's zero crossings
+class FixedPointPhaseTests : public juce::UnitTest
+{
+public:
+    FixedPointPhaseTests() : juce::UnitTest("Fixed Point Phase", "KrumSampler") {}
+
+    void runTest() override
+    {
+        KrumSampleData::Ptr data = new KrumSampleData();
+        data->allocate(1, 96000);
+
+        juce::Random random(1);
+        auto* samples = data->getWritePointer(0);
+        for (int i = 0; i < data->length; i++)
+        {
+            samples[i] = random.nextFloat() * 2.0f - 1.0f;
+        }
+
+        const double semitones[] = { -12.0, -4.0, 0.0, 0.5, 7.0, 12.0 };
+
+        for (auto semitone : semitones)
+        {
+            for (auto reverse : { false, true })
+            {
+                beginTest(juce::String(semitone, 1) + " semitones" + (reverse ? ", reversed" : ""));
+
+                compare<KrumRender::linear>(*data, semitone, reverse);
+                compare<KrumRender::hermite>(*data, semitone, reverse);
+            }
+        }
+    }
+
+private:
+    template <int Interp>
+    void compare(const KrumSampleData& data, double semitone, bool reverse)
+    {
+        const double ratio = std::pow(2.0, semitone / 12.0);
+
+        auto fixedPoint = renderKernel(data, ratio, reverse, (KrumRender::Interpolation)Interp);
+        auto doublePosition = renderDouble<Interp>(data, ratio, reverse);
+
+        expect(std::abs(fixedPoint.size() - doublePosition.size()) <= 1, "rendered " + juce::String(fixedPoint.size())
+               + " samples, the double position rendered " + juce::String(doublePosition.size()));
+
+        float maxDifference = 0.0f;
+        for (int i = 0; i < juce::jmin(fixedPoint.size(), doublePosition.size()); i++)
+        {
+            maxDifference = juce::jmax(maxDifference, std::abs(fixedPoint[i] - doublePosition[i]));
+        }
+
+        //the differences come from the increment being rounded to 1/2^32 of a sample, they're around 1.0e-5 at the most (-100dB)
+        expectLessThan(maxDifference, 1.0e-4f);
+    }
+
+    //the bounds are set up the same as KrumVoice::startNote() does for the whole sample
+    juce::Array<float> renderKernel(const KrumSampleData& data, double ratio, bool reverse, KrumRender::Interpolation interpolation)
+    {
+        KrumRender::VoiceRenderState state;
+        state.inL = data.getReadPointer(0);
+        state.position = KrumRender::toPhase(reverse ? data.length - 1 : 0);
+        state.increment = KrumRender::toPhase(ratio);
+        state.lowerBound = 0;
+        state.upperBound = KrumRender::toPhase(reverse ? data.length : data.length - 1);
+        state.gainL = 1.0f;
+        state.gainR = 1.0f;
+
+        if (state.increment == KrumRender::toPhase(1.0))
+        {
+            interpolation = KrumRender::none;
+        }
+
+        auto kernel = KrumRender::getKernel(reverse, false, false, interpolation);
+
+        float out[KrumRender::renderChunkSize], scratchL[KrumRender::renderChunkSize], scratchR[KrumRender::renderChunkSize];
+        juce::Array<float> rendered;
+
+        while (!state.isFinished())
+        {
+            juce::FloatVectorOperations::clear(out, KrumRender::renderChunkSize);
+            int numRendered = kernel(state, out, nullptr, nullptr, 1.0f, scratchL, scratchR, KrumRender::renderChunkSize);
+            rendered.addArray(out, numRendered);
+        }
+
+        return rendered;
+    }
+
+    //the loop the kernels had before the position was fixed point
+    template <int Interp>
+    juce::Array<float> renderDouble(const KrumSampleData& data, double ratio, bool reverse)
+    {
+        const float* in = data.getReadPointer(0);
+        const double increment = reverse ? -ratio : ratio;
+        const double upperBound = reverse ? data.length : data.length - 1;
+
+        double position = reverse ? data.length - 1 : 0;
+        juce::Array<float> rendered;
+
+        while (true)
+        {
+            auto pos = (int)position;
+            auto alpha = (float)(position - pos);
+
+            rendered.add(KrumRender::interpolate<Interp>(in, pos, alpha, nullptr));
+
+            position += increment;
+            if (position > upperBound || position < 0.0)
+            {
+                break;
+            }
+        }
+
+        return rendered;
+    }
+};
+
+static FixedPointPhaseTests fixedPointPhaseTests;
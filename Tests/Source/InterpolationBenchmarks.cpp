@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    InterpolationBenchmarks.cpp
+    Created: 18 Oct 2026 1:02:27am
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumTestHelpers.h"
+
+//What each interpolation mode costs a voice, through the whole voice (startNote(), the envelope and the kernels) for a stereo sample.
+//Each row is a pitch, the sinc tables change with the pitch band so it's not the same cost all the way up, see KrumResampler.
+//The sampler is rendered directly, not through processBlock(), so the load watcher never swaps the mode out from under us
+class InterpolationBenchmarks : public juce::UnitTest
+{
+public:
+    InterpolationBenchmarks() : juce::UnitTest("Interpolation", "KrumSamplerBenchmarks") {}
+
+    void runTest() override
+    {
+        KrumSamplerAudioProcessor processor;
+        processor.prepareToPlay(48000.0, blockSize);
+
+        auto file = KrumTest::writeTestSample("Interpolation", 2, 48000.0, 2.0);
+
+        beginTest("Load");
+        expect(KrumTest::loadModuleSample(processor, 0, file, testNote), "the test sample didn't load");
+
+        auto& sampler = processor.getSampler();
+        auto* module = sampler.getModule(0);
+        auto globalTree = processor.getValueTree()->getChildWithName(TreeIDs::GLOBALSETTINGS);
+
+        const float semitones[] = { -12.0f, -7.0f, 0.0f, 1.0f, 7.0f, 12.0f };
+        const KrumRender::Interpolation modes[] = { KrumRender::linear, KrumRender::hermite, KrumRender::sinc };
+
+        beginTest("Cost per voice");
+        logMessage("ns per output sample, and % of one core per voice at 48kHz");
+
+        for (auto semitone : semitones)
+        {
+            *module->getModulePitchShift() = semitone;
+            auto row = (semitone > 0 ? "+" : "") + juce::String((int)semitone) + " semitones";
+
+            for (auto mode : modes)
+            {
+                globalTree.setProperty(TreeIDs::interpolationMode, (int)mode, nullptr);
+
+                auto seconds = timeVoice(sampler);
+                row += "    " + getModeName(mode) + " " + juce::String(seconds * 1.0e9, 1) + " ns (" + juce::String(seconds * 48000.0 * 100.0, 3) + "%)";
+
+                //unpitched never interpolates, the modes are all the same
+                if (semitone == 0.0f)
+                {
+                    break;
+                }
+            }
+
+            logMessage(row);
+        }
+
+        *module->getModulePitchShift() = 0.0f;
+    }
+
+private:
+    static constexpr int blockSize = 512;
+    static constexpr int testNote = 60;
+
+    static juce::String getModeName(KrumRender::Interpolation mode)
+    {
+        return mode == KrumRender::sinc ? "sinc" : mode == KrumRender::hermite ? "hermite" : "linear";
+    }
+
+    //plays the note until the voice stops, returns the seconds per output sample
+    double timeVoice(KrumSampler& sampler)
+    {
+        juce::AudioBuffer<float> output(2, blockSize);
+        juce::MidiBuffer midi;
+        juce::int64 numRendered = 0;
+
+        auto seconds = KrumTest::timeAverage([&]()
+        {
+            {
+                const juce::ScopedLock sl(sampler.getLock());
+                sampler.noteOn(1, testNote, 1.0f);
+            }
+
+            numRendered = 0;
+
+            while (isPlaying(sampler))
+            {
+                output.clear();
+                sampler.renderNextBlock(output, midi, 0, blockSize);
+                numRendered += blockSize;
+            }
+        });
+
+        expectGreaterThan(numRendered, (juce::int64)0);
+        return seconds / (double)juce::jmax((juce::int64)1, numRendered);
+    }
+
+    static bool isPlaying(KrumSampler& sampler)
+    {
+        for (int i = 0; i < sampler.getNumVoices(); i++)
+        {
+            if (sampler.getVoice(i)->isVoiceActive())
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+static InterpolationBenchmarks interpolationBenchmarks;
@@ -0,0 +1,190 @@
+/*
+  ==============================================================================
+
+    KernelBenchmarks.cpp
+    Created: 18 Oct 2026 12:21:36am
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumTestHelpers.h"
+
+//How fast one voice renders through the kernels, see KrumRenderKernels.h, against the per-sample loop the voices had before them.
+//Each kernel is run as the scalar version and the vector one for whatever this build has (SimdFloats::name), with the speedup between them.
+//Each case plays a 4 second sample of noise to the end in 512 sample blocks, the way the voice does. The voices at 48kHz column
+//is how many of them one core could keep up with if it did nothing else, it's only there to make the numbers easier to read
+class KernelBenchmarks : public juce::UnitTest
+{
+public:
+    KernelBenchmarks() : juce::UnitTest("Render Kernels", "KrumSamplerBenchmarks") {}
+
+    void runTest() override
+    {
+        const int numSamples = 48000 * 4;
+
+        for (int numChannels = 1; numChannels <= 2; numChannels++)
+        {
+            auto data = KrumTest::makeNoiseData(numChannels, numSamples);
+            const juce::String source = numChannels > 1 ? "stereo" : "mono";
+
+            beginTest(source + " source, " + juce::String(KrumRender::SimdFloats::name));
+
+            //the old loop only had linear interpolation and a juce::ADSR it stepped every sample
+            logResult("old loop, forward, +1 semitone", benchmarkOldLoop(*data, semitoneRatio));
+
+            for (auto reverse : { false, true })
+            {
+                const juce::String direction = reverse ? "reverse" : "forward";
+
+                for (auto enveloped : { false, true })
+                {
+                    const juce::String envelope = enveloped ? "enveloped" : "flat envelope";
+
+                    compareKernels("unity, " + direction + ", " + envelope, *data, 1.0, reverse, KrumRender::none, enveloped);
+                    compareKernels("linear, " + direction + ", +1 semitone, " + envelope, *data, semitoneRatio, reverse, KrumRender::linear, enveloped);
+                    compareKernels("hermite, " + direction + ", +1 semitone, " + envelope, *data, semitoneRatio, reverse, KrumRender::hermite, enveloped);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr int blockSize = 512;
+    const double semitoneRatio = std::pow(2.0, 1.0 / 12.0);
+
+    void logResult(const juce::String& name, double samplesPerSecond)
+    {
+        expectGreaterThan(samplesPerSecond, 0.0);
+
+        logMessage(name.paddedRight(' ', 52) + juce::String(samplesPerSecond / 1.0e6, 1) + " M samples/s    "
+                   + juce::String((int)(samplesPerSecond / 48000.0)) + " voices at 48kHz");
+    }
+
+    void compareKernels(const juce::String& name, const KrumSampleData& data, double ratio, bool reverse, KrumRender::Interpolation interpolation, bool enveloped)
+    {
+        const double scalar = benchmarkKernel(data, ratio, reverse, interpolation, enveloped, false);
+        const double vector = benchmarkKernel(data, ratio, reverse, interpolation, enveloped, true);
+
+        expectGreaterThan(scalar, 0.0);
+        expectGreaterThan(vector, 0.0);
+
+        logMessage(name.paddedRight(' ', 52) + "scalar " + juce::String(scalar / 1.0e6, 1) + " M samples/s    "
+                   + juce::String(KrumRender::SimdFloats::name) + " " + juce::String(vector / 1.0e6, 1) + " M samples/s    x"
+                   + juce::String(vector / scalar, 2) + "    " + juce::String((int)(vector / 48000.0)) + " voices at 48kHz");
+    }
+
+    //returns samples rendered per second, the voice is set up like KrumVoice::startNote() does for the whole sample
+    double benchmarkKernel(const KrumSampleData& data, double ratio, bool reverse, KrumRender::Interpolation interpolation, bool enveloped, bool vector)
+    {
+        const bool stereoSource = data.getNumChannels() > 1;
+        auto kernel = vector ? KrumRender::getKernel(reverse, stereoSource, true, interpolation)
+                             : KrumRender::getScalarKernel(reverse, stereoSource, true, interpolation);
+
+        juce::AudioBuffer<float> output(2, blockSize);
+        juce::HeapBlock<float> envelope(KrumRender::renderChunkSize);
+        juce::FloatVectorOperations::fill(envelope, 0.8f, KrumRender::renderChunkSize);
+
+        float scratchL[KrumRender::renderChunkSize], scratchR[KrumRender::renderChunkSize];
+        juce::int64 numRendered = 0;
+
+        auto seconds = KrumTest::timeAverage([&]()
+        {
+            KrumRender::VoiceRenderState state;
+            state.inL = data.getReadPointer(0);
+            state.inR = stereoSource ? data.getReadPointer(1) : nullptr;
+            state.position = KrumRender::toPhase(reverse ? data.length - 1 : 0);
+            state.increment = KrumRender::toPhase(ratio);
+            state.lowerBound = 0;
+            state.upperBound = KrumRender::toPhase(reverse ? data.length : data.length - 1);
+            state.gainL = 0.7f;
+            state.gainR = 0.6f;
+
+            numRendered = 0;
+
+            while (!state.isFinished())
+            {
+                output.clear();
+
+                for (int start = 0; start < blockSize && !state.isFinished();)
+                {
+                    start += kernel(state, output.getWritePointer(0, start), output.getWritePointer(1, start), enveloped ? envelope.get() : nullptr,
+                                    0.8f, scratchL, scratchR, juce::jmin(KrumRender::renderChunkSize, blockSize - start));
+                }
+
+                numRendered += blockSize;
+            }
+        });
+
+        return (double)numRendered / seconds;
+    }
+
+    //what KrumVoice::renderNextBlock() did before the kernels, forward only
+    double benchmarkOldLoop(const KrumSampleData& data, double ratio)
+    {
+        const float* inL = data.getReadPointer(0);
+        const float* inR = data.getNumChannels() > 1 ? data.getReadPointer(1) : nullptr;
+        const float clipGain = 1.0f, lgain = 0.7f, rgain = 0.6f;
+
+        juce::AudioBuffer<float> output(2, blockSize);
+        juce::ADSR adsr;
+        adsr.setSampleRate(48000.0);
+        adsr.setParameters({ 0.0f, 0.0f, 0.8f, 0.1f });
+
+        juce::int64 numRendered = 0;
+
+        auto seconds = KrumTest::timeAverage([&]()
+        {
+            double sourceSamplePosition = 0.0;
+            bool playing = true;
+            adsr.noteOn();
+
+            numRendered = 0;
+
+            while (playing)
+            {
+                output.clear();
+
+                float* outL = output.getWritePointer(0);
+                float* outR = output.getWritePointer(1);
+                int numSamples = blockSize;
+
+                while (--numSamples >= 0)
+                {
+                    auto pos = (int)sourceSamplePosition;
+                    auto alpha = (float)(sourceSamplePosition - pos);
+                    auto invAlpha = 1.0f - alpha;
+
+                    float l = (inL[pos] * invAlpha + inL[pos + 1] * alpha);
+                    float r = (inR != nullptr) ? (inR[pos] * invAlpha + inR[pos + 1] * alpha) : l;
+
+                    l = clipGain * l;
+                    r = clipGain * r;
+
+                    auto envelopeValue = adsr.getNextSample();
+
+                    l *= lgain * envelopeValue;
+                    r *= rgain * envelopeValue;
+
+                    *outL++ += l;
+                    *outR++ += r;
+
+                    sourceSamplePosition += ratio;
+                    if (sourceSamplePosition > data.length - 1)
+                    {
+                        playing = false;
+                        break;
+                    }
+                }
+
+                numRendered += blockSize;
+            }
+
+            adsr.reset();
+        });
+
+        return (double)numRendered / seconds;
+    }
+};
+
+static KernelBenchmarks kernelBenchmarks;
@@ -0,0 +1,194 @@
+/*
+  ==============================================================================
+
+    KrumTestHelpers.cpp
+    Created: 17 Oct 2026 11:58:40pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumTestHelpers.h"
+
+//counted per thread, only the thread that's being tested is looked at
+static thread_local juce::int64 numAllocations = 0;
+
+void* operator new(std::size_t size)
+{
+    ++numAllocations;
+
+    if (auto* memory = std::malloc(size > 0 ? size : 1))
+    {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    ++numAllocations;
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* memory) noexcept                             { std::free(memory); }
+void operator delete[](void* memory) noexcept                           { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept                { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept              { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept      { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept    { std::free(memory); }
+
+//==================================================================================================//
+
+KrumTest::ScopedAllocationCounter::ScopedAllocationCounter()
+    : startCount(numAllocations)
+{
+}
+
+int KrumTest::ScopedAllocationCounter::getNumAllocations() const
+{
+    return (int)(numAllocations - startCount);
+}
+
+juce::File KrumTest::getTestFolder()
+{
+    auto folder = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("KrumSamplerTests");
+    folder.createDirectory();
+    return folder;
+}
+
+juce::File KrumTest::writeTestSample(const juce::String& name, int numChannels, double sampleRate, double lengthSeconds, int bitsPerSample)
+{
+    auto file = getTestFolder().getChildFile(name + ".wav");
+    file.deleteFile();
+
+    const int numSamples = (int)(lengthSeconds * sampleRate);
+    juce::AudioBuffer<float> buffer(numChannels, numSamples);
+
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        //the channels are a little apart so a stereo sound really is stereo
+        const double frequency = 110.0 * (1.0 + channel * 0.01);
+
+        for (int i = 0; i < numSamples; i++)
+        {
+            const double time = i / sampleRate;
+            buffer.setSample(channel, i, (float)(0.8 * std::exp(-6.0 * time) * std::sin(juce::MathConstants<double>::twoPi * frequency * time)));
+        }
+    }
+
+    juce::WavAudioFormat wavFormat;
+    auto* stream = new juce::FileOutputStream(file);
+    std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(stream, sampleRate, (unsigned int)numChannels, bitsPerSample, {}, 0));
+
+    if (writer == nullptr)
+    {
+        //the writer only takes the stream if it was made
+        delete stream;
+        return {};
+    }
+
+    writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+    return file;
+}
+
+bool KrumTest::loadModuleSample(KrumSamplerAudioProcessor& processor, int moduleIndex, const juce::File& file, int midiNote)
+{
+    auto moduleTree = processor.getValueTree()->getChildWithName(TreeIDs::KRUMMODULES).getChild(moduleIndex);
+
+    moduleTree.setProperty(TreeIDs::moduleName, file.getFileNameWithoutExtension(), nullptr);
+    moduleTree.setProperty(TreeIDs::moduleMidiNote, midiNote, nullptr);
+    moduleTree.setProperty(TreeIDs::moduleMidiChannel, 1, nullptr);
+    moduleTree.setProperty(TreeIDs::moduleState, KrumModule::ModuleState::active, nullptr);
+    moduleTree.setProperty(TreeIDs::moduleFile, file.getFullPathName(), nullptr);
+
+    auto& sampler = processor.getSampler();
+    return waitFor([&sampler, moduleIndex]()
+    {
+        return !sampler.isModuleLoading(moduleIndex) && sampler.getModule(moduleIndex)->getPlaybackSound() != nullptr;
+    });
+}
+
+void KrumTest::setPolyphony(KrumSamplerAudioProcessor& processor, int numVoices)
+{
+    processor.getValueTree()->getChildWithName(TreeIDs::GLOBALSETTINGS).setProperty(TreeIDs::polyphony, numVoices, nullptr);
+}
+
+int KrumTest::getNumActiveVoices(KrumSampler& sampler)
+{
+    int numActive = 0;
+    for (int i = 0; i < sampler.getNumVoices(); i++)
+    {
+        if (sampler.getVoice(i)->isVoiceActive())
+        {
+            ++numActive;
+        }
+    }
+
+    return numActive;
+}
+
+bool KrumTest::waitFor(const std::function<bool()>& condition, int timeoutMs)
+{
+    const auto endTime = juce::Time::getMillisecondCounter() + (juce::uint32)timeoutMs;
+
+    while (!condition())
+    {
+        if (juce::Time::getMillisecondCounter() > endTime)
+        {
+            return false;
+        }
+
+        juce::MessageManager::getInstance()->runDispatchLoopUntil(5);
+    }
+
+    return true;
+}
+
+KrumSampleData::Ptr KrumTest::makeNoiseData(int numChannels, int numSamples)
+{
+    KrumSampleData::Ptr data = new KrumSampleData();
+    data->allocate(numChannels, numSamples);
+    data->sampleRate = 48000.0;
+
+    juce::Random random(1);
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        auto* samples = data->getWritePointer(channel);
+        for (int i = 0; i < numSamples; i++)
+        {
+            samples[i] = random.nextFloat() * 2.0f - 1.0f;
+        }
+    }
+
+    return data;
+}
+
+double KrumTest::timeAverage(const std::function<void()>& function, double minSeconds)
+{
+    function();
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    int numCalls = 0;
+    double seconds = 0.0;
+
+    do
+    {
+        function();
+        ++numCalls;
+        seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    }
+    while (seconds < minSeconds);
+
+    return seconds / numCalls;
+}
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    KrumTestHelpers.h
+    Created: 17 Oct 2026 11:58:40pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+/*
+*
+* Bits shared by the engine tests and benchmarks. Everything here runs on the message thread (the main thread of the test app),
+* the sampler publishes it's loads there, so waitFor() runs the message loop while it waits.
+*
+*/
+
+namespace KrumTest
+{
+    //where the test samples are written, they're left there and written over on the next run
+    juce::File getTestFolder();
+
+    //a decaying sine written to a WAV (24 bit unless it's asked for), so it has a tail for the sampler to trim like a real drum hit
+    juce::File writeTestSample(const juce::String& name, int numChannels, double sampleRate, double lengthSeconds, int bitsPerSample = 24);
+
+    //Puts the file on the module the way dropping it on the module's editor does, mapped to midiNote on channel 1,
+    //then waits for the sound to be published. Returns false if it never was
+    bool loadModuleSample(KrumSamplerAudioProcessor& processor, int moduleIndex, const juce::File& file, int midiNote);
+
+    //sets the polyphony in the global settings, the way the editor does
+    void setPolyphony(KrumSamplerAudioProcessor& processor, int numVoices);
+
+    //the sampler's voices that are playing something, call it with the sampler's lock held
+    int getNumActiveVoices(KrumSampler& sampler);
+
+    //runs the message loop until the condition is true, returns false if the timeout came first
+    bool waitFor(const std::function<bool()>& condition, int timeoutMs = 10000);
+
+    //white noise, so the benchmarks can't get off easy on silence or a repeating shape
+    KrumSampleData::Ptr makeNoiseData(int numChannels, int numSamples);
+
+    //Calls function once to warm up, then keeps calling it until minSeconds have gone by.
+    //Returns the average seconds per call, for the benchmarks
+    double timeAverage(const std::function<void()>& function, double minSeconds = 0.5);
+
+    //Counts the heap allocations made by this thread while it's in scope. The test app replaces the global operator new to do the counting,
+    //see KrumTestHelpers.cpp, so anything that goes through new (juce::String, juce::Array, std::vector...) is caught.
+    class ScopedAllocationCounter
+    {
+    public:
+        ScopedAllocationCounter();
+
+        int getNumAllocations() const;
+
+    private:
+        const juce::int64 startCount;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedAllocationCounter)
+    };
+}
@@ -0,0 +1,41 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    Created: 17 Oct 2026 11:58:12pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+/*
+*
+* Runs the sampler's engine tests, or the benchmarks with --benchmarks. The tests are the juce::UnitTests in the "KrumSampler" category,
+* the benchmarks are in "KrumSamplerBenchmarks", build Release for numbers worth reading.
+*
+* Returns 1 if any test failed, so a build can be gated on it.
+*
+*/
+
+int main(int argc, char* argv[])
+{
+    //the sampler's loads are published on the message thread, this thread is it
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ArgumentList args(argc, argv);
+    const bool runBenchmarks = args.containsOption("--benchmarks");
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runTestsInCategory(runBenchmarks ? "KrumSamplerBenchmarks" : "KrumSampler");
+
+    int numFailures = 0;
+    for (int i = 0; i < runner.getNumResults(); i++)
+    {
+        numFailures += runner.getResult(i)->failures;
+    }
+
+    return numFailures > 0 ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+/*
+  ==============================================================================
+
+    MappedPlaybackTests.cpp
+    Created: 18 Oct 2026 2:41:15am
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumTestHelpers.h"
+#include "../../Source/KrumSampleData.h"
+
+//A 16 or 24 bit WAV is played straight out of the memory mapped file, see KrumPackedSampleData::map(). This decodes the mapped file, and the
+//same file packed the normal way, and checks both give back exactly the floats JUCE's reader does. Forwards, backwards, and hanging off the ends
+class MappedPlaybackTests : public juce::UnitTest
+{
+public:
+    MappedPlaybackTests() : juce::UnitTest("Mapped Playback", "KrumSampler") {}
+
+    void runTest() override
+    {
+        formatManager.registerBasicFormats();
+
+        for (auto bitsPerSample : { 16, 24 })
+        {
+            for (auto numChannels : { 1, 2 })
+            {
+                beginTest(juce::String(bitsPerSample) + " bit, " + juce::String(numChannels) + " channels");
+
+                auto file = KrumTest::writeTestSample("Mapped" + juce::String(bitsPerSample) + "_" + juce::String(numChannels),
+                                                      numChannels, 48000.0, 0.25, bitsPerSample);
+                checkFile(file);
+            }
+        }
+    }
+
+private:
+    void checkFile(const juce::File& file)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+        expect(reader != nullptr, "couldn't read " + file.getFileName());
+        if (reader == nullptr)
+        {
+            return;
+        }
+
+        const int length = (int)reader->lengthInSamples;
+        const int numChannels = (int)reader->numChannels;
+
+        juce::AudioBuffer<float> expected(numChannels, length);
+        reader->read(&expected, 0, length, 0, true, true);
+
+        KrumPackedSampleData packed;
+        packed.read(*reader, length);
+        expect(!packed.isMapped());
+
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader(wavFormat.createMemoryMappedReader(file));
+        expect(mappedReader != nullptr && mappedReader->mapEntireFile(), "couldn't map " + file.getFileName());
+        if (mappedReader == nullptr)
+        {
+            return;
+        }
+
+        std::unique_ptr<juce::AudioFormatReader> mappedFileReader(mappedReader.release());
+
+        KrumPackedSampleData mapped;
+        expect(mapped.map(mappedFileReader, length), "the file wasn't mapped");
+        expect(mapped.isMapped());
+        expect(mappedFileReader == nullptr, "the reader should go with the mapping");
+
+        expectEquals(mapped.getNumChannels(), packed.getNumChannels());
+        expectEquals(mapped.firstAudibleSample, packed.firstAudibleSample);
+        expectEquals(mapped.lastAudibleSample, packed.lastAudibleSample);
+
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            //the whole file both ways, then odd sized stretches over the ends, so the vector conversions get their leftovers too
+            checkDecode(packed, mapped, expected, channel, 0, false, length);
+            checkDecode(packed, mapped, expected, channel, length - 1, true, length);
+            checkDecode(packed, mapped, expected, channel, -7, false, 23);
+            checkDecode(packed, mapped, expected, channel, length - 13, false, 31);
+            checkDecode(packed, mapped, expected, channel, 9, true, 26);
+            checkDecode(packed, mapped, expected, channel, length + 5, true, 19);
+        }
+    }
+
+    void checkDecode(const KrumPackedSampleData& packed, const KrumPackedSampleData& mapped, const juce::AudioBuffer<float>& expected,
+                     int channel, juce::int64 position, bool reverse, int numSamples)
+    {
+        std::vector<float> fromPacked((size_t)numSamples), fromMapped((size_t)numSamples);
+        packed.decode(channel, position, reverse, fromPacked.data(), numSamples);
+        mapped.decode(channel, position, reverse, fromMapped.data(), numSamples);
+
+        int numWrong = 0;
+        for (int i = 0; i < numSamples; i++)
+        {
+            const juce::int64 filePosition = reverse ? position - i : position + i;
+            const float sample = (filePosition >= 0 && filePosition < expected.getNumSamples()) ? expected.getSample(channel, (int)filePosition) : 0.0f;
+
+            if (fromPacked[(size_t)i] != sample || fromMapped[(size_t)i] != sample)
+            {
+                ++numWrong;
+            }
+        }
+
+        expectEquals(numWrong, 0, "channel " + juce::String(channel) + " from " + juce::String(position) + (reverse ? " reversed" : ""));
+    }
+
+    juce::AudioFormatManager formatManager;
+};
+
+static MappedPlaybackTests mappedPlaybackTests;
@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    NoteDispatchBenchmarks.cpp
+    Created: 18 Oct 2026 12:47:52am
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumTestHelpers.h"
+
+//What a note on costs as more modules are mapped to the note, see KrumSampler::noteOn(). The dispatch table means the modules mapped
+//to other notes should cost nothing, so every run has the whole kit loaded and only moves how many of them share the note.
+//Each note on is followed by allNotesOff() so the voices are free again for the next one, that's in the time too.
+class NoteDispatchBenchmarks : public juce::UnitTest
+{
+public:
+    NoteDispatchBenchmarks() : juce::UnitTest("Note Dispatch", "KrumSamplerBenchmarks") {}
+
+    void runTest() override
+    {
+        auto file = KrumTest::writeTestSample("NoteDispatch", 2, 48000.0, 0.5);
+
+        beginTest("Unmapped note");
+        {
+            KrumSamplerAudioProcessor processor;
+            loadKit(processor, file, 0);
+
+            auto microseconds = timeNoteOn(processor.getSampler(), 0);
+            logMessage("no modules on the note: " + juce::String(microseconds, 3) + " us per note on");
+        }
+
+        const int modulesPerNote[] = { 1, 2, 4, 8, 16, MAX_NUM_MODULES };
+
+        for (auto numOnNote : modulesPerNote)
+        {
+            beginTest(juce::String(numOnNote) + " modules on the note");
+
+            KrumSamplerAudioProcessor processor;
+            loadKit(processor, file, numOnNote);
+
+            auto microseconds = timeNoteOn(processor.getSampler(), numOnNote);
+            logMessage(juce::String(microseconds, 3) + " us per note on, " + juce::String(microseconds / numOnNote, 3) + " us per module");
+        }
+    }
+
+private:
+    static constexpr int testNote = 60;
+    static constexpr int notesPerCall = 100;
+
+    //every module gets the file, the first numOnNote of them on testNote and the rest on notes of their own
+    void loadKit(KrumSamplerAudioProcessor& processor, const juce::File& file, int numOnNote)
+    {
+        processor.prepareToPlay(48000.0, 512);
+
+        //enough voices that nothing is stolen, it's the dispatch that's being timed
+        KrumTest::setPolyphony(processor, 64);
+
+        for (int i = 0; i < MAX_NUM_MODULES; i++)
+        {
+            expect(KrumTest::loadModuleSample(processor, i, file, i < numOnNote ? testNote : 36 + i), "module " + juce::String(i) + " didn't load");
+        }
+    }
+
+    //microseconds per note on
+    double timeNoteOn(KrumSampler& sampler, int numOnNote)
+    {
+        auto seconds = KrumTest::timeAverage([&sampler]()
+        {
+            const juce::ScopedLock sl(sampler.getLock());
+
+            for (int i = 0; i < notesPerCall; i++)
+            {
+                sampler.noteOn(1, testNote, 1.0f);
+                sampler.allNotesOff(0, false);
+            }
+        });
+
+        //make sure the note started a voice for each module on it, and nothing else
+        {
+            const juce::ScopedLock sl(sampler.getLock());
+            sampler.noteOn(1, testNote, 1.0f);
+
+            int numActive = 0;
+            for (int i = 0; i < sampler.getNumVoices(); i++)
+            {
+                if (sampler.getVoice(i)->isVoiceActive())
+                {
+                    ++numActive;
+                }
+            }
+
+            expectEquals(numActive, numOnNote);
+            sampler.allNotesOff(0, false);
+        }
+
+        return seconds * 1.0e6 / notesPerCall;
+    }
+};
+
+static NoteDispatchBenchmarks noteDispatchBenchmarks;
@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+    RestoreBenchmarks.cpp
+    Created: 18 Oct 2026 12:34:10am
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumTestHelpers.h"
+
+//How long a full kit takes to come back when a session is opened, from setStateInformation() until the whole kit is published.
+//Cold is every file read and decoded, each run points the kit at fresh copies of the files so the sample pool has never seen them.
+//Shared is another instance already playing the same kit, so every module gets it's data from the sample pool, see KrumSamplePool.
+//The OS file cache is warm in both, so cold is the decode, not the disk
+class RestoreBenchmarks : public juce::UnitTest
+{
+public:
+    RestoreBenchmarks() : juce::UnitTest("Kit Restore", "KrumSamplerBenchmarks") {}
+
+    void runTest() override
+    {
+        beginTest("Make the kit");
+
+        //the kit stays loaded for the whole benchmark, it's the other instance for the shared runs
+        KrumSamplerAudioProcessor kit;
+        kit.prepareToPlay(48000.0, 512);
+
+        juce::Array<juce::File> kitFiles;
+        for (int i = 0; i < MAX_NUM_MODULES; i++)
+        {
+            auto file = KrumTest::writeTestSample("RestoreKit" + juce::String(i), 2, 48000.0, 1.5);
+            expect(KrumTest::loadModuleSample(kit, i, file, 36 + i), "module " + juce::String(i) + " didn't load");
+            kitFiles.add(file);
+        }
+
+        juce::MemoryBlock kitState;
+        kit.getStateInformation(kitState);
+
+        juce::SharedResourcePointer<KrumSamplePool> samplePool;
+
+        beginTest("Cold");
+        {
+            juce::Array<double> times;
+            auto misses = samplePool->getNumMisses();
+
+            for (int run = 0; run < numRuns; run++)
+            {
+                juce::Array<juce::File> copies;
+                for (int i = 0; i < kitFiles.size(); i++)
+                {
+                    auto copy = KrumTest::getTestFolder().getChildFile("RestoreCold" + juce::String(i) + "_" + juce::String(run) + ".wav");
+                    kitFiles[i].copyFileTo(copy);
+                    copies.add(copy);
+                }
+
+                times.add(timeRestore(withFiles(kitState, copies)));
+
+                for (auto& copy : copies)
+                {
+                    copy.deleteFile();
+                }
+            }
+
+            logTimes(times);
+            logMessage("pool misses: " + juce::String(samplePool->getNumMisses() - misses));
+        }
+
+        beginTest("Shared with another instance");
+        {
+            juce::Array<double> times;
+            auto hits = samplePool->getNumHits();
+
+            for (int run = 0; run < numRuns; run++)
+            {
+                times.add(timeRestore(kitState));
+            }
+
+            logTimes(times);
+            logMessage("pool hits: " + juce::String(samplePool->getNumHits() - hits));
+        }
+    }
+
+private:
+    static constexpr int numRuns = 5;
+
+    //restores the state into a new instance, returns the milliseconds until the kit is published
+    double timeRestore(const juce::MemoryBlock& state)
+    {
+        KrumSamplerAudioProcessor processor;
+        processor.prepareToPlay(48000.0, 512);
+
+        auto& sampler = processor.getSampler();
+        const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+        processor.setStateInformation(state.getData(), (int)state.getSize());
+        sampler.waitForRestoreLoads();
+
+        const auto milliseconds = juce::Time::getMillisecondCounterHiRes() - startTime;
+
+        int numLoaded = 0;
+        for (int i = 0; i < MAX_NUM_MODULES; i++)
+        {
+            if (sampler.getModule(i)->getPlaybackSound() != nullptr)
+            {
+                ++numLoaded;
+            }
+        }
+
+        expectEquals(numLoaded, MAX_NUM_MODULES);
+        return milliseconds;
+    }
+
+    //the same state with each module pointed at a different file
+    juce::MemoryBlock withFiles(const juce::MemoryBlock& state, const juce::Array<juce::File>& files)
+    {
+        auto xml = juce::AudioProcessor::getXmlFromBinary(state.getData(), (int)state.getSize());
+        auto tree = juce::ValueTree::fromXml(*xml);
+        auto modulesTree = tree.getChildWithName(TreeIDs::KRUMMODULES);
+
+        for (int i = 0; i < files.size(); i++)
+        {
+            modulesTree.getChild(i).setProperty(TreeIDs::moduleFile, files[i].getFullPathName(), nullptr);
+        }
+
+        juce::MemoryBlock newState;
+        juce::AudioProcessor::copyXmlToBinary(*tree.createXml(), newState);
+        return newState;
+    }
+
+    void logTimes(const juce::Array<double>& times)
+    {
+        double total = 0.0, fastest = times.getFirst();
+        for (auto time : times)
+        {
+            total += time;
+            fastest = juce::jmin(fastest, time);
+        }
+
+        logMessage(juce::String(MAX_NUM_MODULES) + " modules, average " + juce::String(total / times.size(), 1) + " ms, fastest "
+                   + juce::String(fastest, 1) + " ms over " + juce::String(times.size()) + " runs");
+    }
+};
+
+static RestoreBenchmarks restoreBenchmarks;
@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    RetriggerTests.cpp
+    Created: 18 Oct 2026 2:10:32am
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumTestHelpers.h"
+
+//Without a voice cap a module retriggers on the voice that's playing it's last hit, with one it can ring that many hits at once,
+//see KrumSampler::allocateVoice(). Neither should count as stealing a voice
+class RetriggerTests : public juce::UnitTest
+{
+public:
+    RetriggerTests() : juce::UnitTest("Retrigger", "KrumSampler") {}
+
+    void runTest() override
+    {
+        KrumSamplerAudioProcessor processor;
+        processor.prepareToPlay(48000.0, 512);
+
+        auto& sampler = processor.getSampler();
+        auto file = KrumTest::writeTestSample("Retrigger", 2, 48000.0, 0.5);
+
+        beginTest("Load");
+        expect(KrumTest::loadModuleSample(processor, 0, file, testNote), "the test sample didn't load");
+        expect(KrumTest::loadModuleSample(processor, 1, file, testNote + 1), "the test sample didn't load");
+
+        auto modulesTree = processor.getValueTree()->getChildWithName(TreeIDs::KRUMMODULES);
+
+        beginTest("No cap reuses the voice");
+        {
+            const juce::ScopedLock sl(sampler.getLock());
+            const auto stolenBefore = sampler.getNumStolenVoices();
+
+            sampler.noteOn(1, testNote, 1.0f);
+            expectEquals(KrumTest::getNumActiveVoices(sampler), 1);
+
+            for (int i = 0; i < 8; i++)
+            {
+                sampler.noteOn(1, testNote, 1.0f);
+            }
+
+            expectEquals(KrumTest::getNumActiveVoices(sampler), 1);
+            expectEquals(sampler.getNumStolenVoices(), stolenBefore);
+
+            //another module still gets a voice of it's own
+            sampler.noteOn(1, testNote + 1, 1.0f);
+            expectEquals(KrumTest::getNumActiveVoices(sampler), 2);
+
+            sampler.allNotesOff(0, false);
+        }
+
+        beginTest("A cap lets the hits ring");
+        {
+            modulesTree.getChild(0).setProperty(TreeIDs::moduleMaxVoices, 4, nullptr);
+
+            const juce::ScopedLock sl(sampler.getLock());
+            const auto stolenBefore = sampler.getNumStolenVoices();
+
+            for (int i = 0; i < 4; i++)
+            {
+                sampler.noteOn(1, testNote, 1.0f);
+            }
+
+            expectEquals(KrumTest::getNumActiveVoices(sampler), 4);
+            expectEquals(sampler.getNumStolenVoices(), stolenBefore);
+
+            //past the cap the module's own quietest voice is stolen
+            sampler.noteOn(1, testNote, 1.0f);
+            expectEquals(KrumTest::getNumActiveVoices(sampler), 4);
+            expectEquals(sampler.getNumStolenVoices(), stolenBefore + 1);
+
+            sampler.allNotesOff(0, false);
+        }
+
+        modulesTree.getChild(0).setProperty(TreeIDs::moduleMaxVoices, 0, nullptr);
+    }
+
+private:
+    static constexpr int testNote = 60;
+};
+
+static RetriggerTests retriggerTests;
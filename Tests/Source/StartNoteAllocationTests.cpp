@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    StartNoteAllocationTests.cpp
+    Created: 17 Oct 2026 11:59:05pm
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumTestHelpers.h"
+
+//startNote() runs on the audio thread for every note, it reads the module's settings through the pointers and the snapshot the module
+//resolved up front, so it should never need the heap
+class StartNoteAllocationTests : public juce::UnitTest
+{
+public:
+    StartNoteAllocationTests() : juce::UnitTest("Start Note Allocations", "KrumSampler") {}
+
+    void runTest() override
+    {
+        KrumSamplerAudioProcessor processor;
+        processor.prepareToPlay(48000.0, 512);
+
+        auto& sampler = processor.getSampler();
+        auto file = KrumTest::writeTestSample("StartNoteAllocations", 2, 48000.0, 0.5);
+
+        beginTest("Load");
+        expect(KrumTest::loadModuleSample(processor, 0, file, 60), "the test sample didn't load");
+
+        auto* module = sampler.getModule(0);
+        juce::SynthesiserSound::Ptr sound = module->getPlaybackSound();
+        auto* voice = dynamic_cast<KrumVoice*>(sampler.getVoice(0));
+
+        if (sound == nullptr || voice == nullptr)
+        {
+            return;
+        }
+
+        beginTest("Unpitched");
+        expectEquals(countStartNoteAllocations(*voice, *sound), 0);
+
+        beginTest("Pitched");
+        *module->getModulePitchShift() = 7.0f;
+        expectEquals(countStartNoteAllocations(*voice, *sound), 0);
+
+        beginTest("Reversed");
+        *module->getModuleReverse() = 1.0f;
+        expectEquals(countStartNoteAllocations(*voice, *sound), 0);
+
+        *module->getModulePitchShift() = 0.0f;
+        *module->getModuleReverse() = 0.0f;
+
+        beginTest("Note on through the sampler");
+        {
+            //the whole audio thread path, the dispatch table, the voice pool and startNote()
+            const juce::ScopedLock sl(sampler.getLock());
+            KrumTest::ScopedAllocationCounter counter;
+
+            for (int i = 0; i < 32; i++)
+            {
+                sampler.noteOn(1, 60, 1.0f);
+            }
+
+            expectEquals(counter.getNumAllocations(), 0);
+        }
+
+        sampler.allNotesOff(0, false);
+    }
+
+private:
+    int countStartNoteAllocations(KrumVoice& voice, juce::SynthesiserSound& sound)
+    {
+        int numAllocations = 0;
+
+        {
+            KrumTest::ScopedAllocationCounter counter;
+            voice.startNote(60, 1.0f, &sound, 8192);
+            numAllocations = counter.getNumAllocations();
+        }
+
+        voice.stopNote(0.0f, false);
+        return numAllocations;
+    }
+};
+
+static StartNoteAllocationTests startNoteAllocationTests;
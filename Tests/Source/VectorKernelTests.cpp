@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    VectorKernelTests.cpp
+    Created: 18 Oct 2026 3:22:47am
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumTestHelpers.h"
+#include "../../Source/KrumRenderKernels.h"
+
+//The vector kernels (SimdFloats) have to render what the scalar ones do. This throws random notes at both, in and out of bounds,
+//every chunk length so the leftovers after the last full vector get a go too, and checks the lengths and positions match exactly
+//and the audio is within a float rounding or two (the compiler can fuse a multiply and add in one and not the other)
+class VectorKernelTests : public juce::UnitTest
+{
+public:
+    VectorKernelTests() : juce::UnitTest("Vector Kernels", "KrumSampler") {}
+
+    void runTest() override
+    {
+        auto data = KrumTest::makeNoiseData(2, 4000);
+
+        float envelope[KrumRender::renderChunkSize];
+        juce::Random random(1);
+        for (auto& level : envelope)
+        {
+            level = random.nextFloat();
+        }
+
+        const KrumRender::Interpolation interpolations[] = { KrumRender::none, KrumRender::linear, KrumRender::hermite };
+
+        for (auto interpolation : interpolations)
+        {
+            beginTest(juce::String(interpolation == KrumRender::none ? "unity" : interpolation == KrumRender::linear ? "linear" : "hermite")
+                      + ", " + KrumRender::SimdFloats::name);
+
+            int numWrongLengths = 0;
+            float maxDifference = 0.0f;
+
+            for (int i = 0; i < numNotes; i++)
+            {
+                const bool reverse = random.nextBool();
+                const bool stereoSource = random.nextBool();
+                const bool stereoOutput = random.nextBool();
+                const bool enveloped = random.nextBool();
+                const int numSamples = 1 + random.nextInt(KrumRender::renderChunkSize);
+
+                //a note somewhere in the first few hundred samples, starting anywhere from just before it's bounds to just after
+                const int lowerBound = random.nextInt(100);
+                const int upperBound = lowerBound + random.nextInt(200);
+                const double ratio = interpolation == KrumRender::none ? 1.0 : std::exp(random.nextDouble() * 6.0 - 3.0);
+
+                KrumRender::VoiceRenderState vectorState;
+                vectorState.inL = data->getReadPointer(0);
+                vectorState.inR = stereoSource ? data->getReadPointer(1) : nullptr;
+                vectorState.increment = KrumRender::toPhase(ratio);
+                vectorState.lowerBound = KrumRender::toPhase(lowerBound);
+                vectorState.upperBound = KrumRender::toPhase(upperBound);
+                vectorState.position = KrumRender::toPhase(lowerBound - 5 + random.nextDouble() * (upperBound - lowerBound + 10));
+                vectorState.gainL = 0.7f;
+                vectorState.gainR = 0.6f;
+
+                auto scalarState = vectorState;
+
+                auto vectorKernel = KrumRender::getKernel(reverse, stereoSource, stereoOutput, interpolation);
+                auto scalarKernel = KrumRender::getScalarKernel(reverse, stereoSource, stereoOutput, interpolation);
+
+                float vectorOut[2][KrumRender::renderChunkSize] = {}, scalarOut[2][KrumRender::renderChunkSize] = {};
+                float scratchL[KrumRender::renderChunkSize], scratchR[KrumRender::renderChunkSize];
+
+                //a few chunks, so the position carried over from the last one is checked as well
+                for (int chunk = 0; chunk < 3 && !scalarState.isFinished(); chunk++)
+                {
+                    const int numVector = vectorKernel(vectorState, vectorOut[0], vectorOut[1], enveloped ? envelope : nullptr, 0.8f,
+                                                       scratchL, scratchR, numSamples);
+                    const int numScalar = scalarKernel(scalarState, scalarOut[0], scalarOut[1], enveloped ? envelope : nullptr, 0.8f,
+                                                       scratchL, scratchR, numSamples);
+
+                    if (numVector != numScalar || vectorState.position != scalarState.position)
+                    {
+                        ++numWrongLengths;
+                    }
+                }
+
+                for (int channel = 0; channel < 2; channel++)
+                {
+                    for (int j = 0; j < KrumRender::renderChunkSize; j++)
+                    {
+                        maxDifference = juce::jmax(maxDifference, std::abs(vectorOut[channel][j] - scalarOut[channel][j]));
+                    }
+                }
+            }
+
+            expectEquals(numWrongLengths, 0);
+            expectLessThan(maxDifference, 1.0e-5f);
+        }
+    }
+
+private:
+    static constexpr int numNotes = 20000;
+};
+
+static VectorKernelTests vectorKernelTests;
@@ -0,0 +1,93 @@
+/*
+  ==============================================================================
+
+    VoicePoolBenchmarks.cpp
+    Created: 18 Oct 2026 1:28:03am
+    Author:  krisc
+
+  ==============================================================================
+*/
+
+#include "KrumTestHelpers.h"
+
+//Note on cost and how often a voice has to be stolen, at the bigger polyphony settings. All 20 modules are loaded and hit at random,
+//a few notes every block, so the pool fills up and stays full at the lower settings. Only the note ons are timed, not the rendering
+class VoicePoolBenchmarks : public juce::UnitTest
+{
+public:
+    VoicePoolBenchmarks() : juce::UnitTest("Voice Pool", "KrumSamplerBenchmarks") {}
+
+    void runTest() override
+    {
+        KrumSamplerAudioProcessor processor;
+        processor.prepareToPlay(48000.0, blockSize);
+
+        auto file = KrumTest::writeTestSample("VoicePool", 2, 48000.0, 1.0);
+
+        beginTest("Load");
+        auto modulesTree = processor.getValueTree()->getChildWithName(TreeIDs::KRUMMODULES);
+
+        for (int i = 0; i < MAX_NUM_MODULES; i++)
+        {
+            expect(KrumTest::loadModuleSample(processor, i, file, firstNote + i), "module " + juce::String(i) + " didn't load");
+
+            //without a cap each module would retrigger on one voice, this lets the hits ring over each other so the pool fills up
+            modulesTree.getChild(i).setProperty(TreeIDs::moduleMaxVoices, MAX_POLYPHONY, nullptr);
+        }
+
+        auto& sampler = processor.getSampler();
+        const int polyphonies[] = { 64, 128, 256 };
+
+        for (auto polyphony : polyphonies)
+        {
+            beginTest(juce::String(polyphony) + " voices");
+
+            KrumTest::setPolyphony(processor, polyphony);
+            expectEquals(sampler.getPolyphony(), polyphony);
+
+            juce::AudioBuffer<float> output(2, blockSize);
+            juce::MidiBuffer midi;
+            juce::Random random(1);
+
+            const auto stolenBefore = sampler.getNumStolenVoices();
+            juce::int64 noteOnTicks = 0;
+
+            for (int block = 0; block < numBlocks; block++)
+            {
+                {
+                    const juce::ScopedLock sl(sampler.getLock());
+                    const auto startTicks = juce::Time::getHighResolutionTicks();
+
+                    for (int i = 0; i < notesPerBlock; i++)
+                    {
+                        sampler.noteOn(1, firstNote + random.nextInt(MAX_NUM_MODULES), 1.0f);
+                    }
+
+                    noteOnTicks += juce::Time::getHighResolutionTicks() - startTicks;
+                }
+
+                output.clear();
+                sampler.renderNextBlock(output, midi, 0, blockSize);
+            }
+
+            sampler.allNotesOff(0, false);
+
+            const int numNotes = numBlocks * notesPerBlock;
+            const auto numStolen = sampler.getNumStolenVoices() - stolenBefore;
+
+            logMessage(juce::String(juce::Time::highResolutionTicksToSeconds(noteOnTicks) * 1.0e6 / numNotes, 3) + " us per note on, "
+                       + juce::String(numStolen) + " of " + juce::String(numNotes) + " notes stole a voice ("
+                       + juce::String(100.0 * numStolen / numNotes, 1) + "%)");
+        }
+    }
+
+private:
+    static constexpr int blockSize = 512;
+    static constexpr int firstNote = 36;
+
+    //about 20 seconds at 48kHz, a one second sample at 4 notes a block wants around 375 voices at once
+    static constexpr int numBlocks = 2000;
+    static constexpr int notesPerBlock = 4;
+};
+
+static VoicePoolBenchmarks voicePoolBenchmarks;